@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# WMFS2 benchmark: run wmfs in Xvfb and drive it with xbench.
+# Usage: bench/run.sh [wmfs binary] [xbench binary] [xbench options]
+# Writes one JSON object per measure on standard output.
+#
+
+WMFS=${1:-./wmfs}
+XBENCH=${2:-bench/xbench}
+[ $# -ge 2 ] && shift 2
+
+DIR=$(dirname "$0")
+DPY=${BENCH_DISPLAY:-:99}
+
+command -v Xvfb > /dev/null || { echo "bench: Xvfb not found" >&2; exit 1; }
+
+Xvfb "$DPY" -screen 0 1280x800x24 -nolisten tcp > /dev/null 2>&1 &
+XPID=$!
+
+trap 'kill $WPID $XPID 2> /dev/null' EXIT INT TERM
+
+# Wait for Xvfb
+i=0
+while [ ! -e "/tmp/.X11-unix/X${DPY#:}" ] && [ $i -lt 50 ]; do
+     sleep 0.1
+     i=$((i + 1))
+done
+
+DISPLAY=$DPY "$WMFS" -C "$DIR/wmfsrc" > /dev/null 2>&1 &
+WPID=$!
+
+DISPLAY=$DPY "$XBENCH" -p $WPID "$@"
+R=$?
+
+# Detailed per event stats go to wmfs log file
+DISPLAY=$DPY "$WMFS" -c stats_dump
+
+exit $R
@@ -0,0 +1,473 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+/*
+ * Synthetic X client driving a running wmfs, see bench/run.sh.
+ * Every measure is written on stdout as one JSON object per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#define TIMEOUT_US (5 * 1000000L)
+
+enum
+{
+     AtomRunning,
+     AtomFunction,
+     AtomCmd,
+     AtomUtf8,
+     AtomCurrentTag,
+     AtomActiveWindow,
+     AtomLast
+};
+
+static char *atom_name[AtomLast] =
+{
+     [AtomRunning]      = "_WMFS_RUNNING",
+     [AtomFunction]     = "_WMFS_FUNCTION",
+     [AtomCmd]          = "_WMFS_CMD",
+     [AtomUtf8]         = "UTF8_STRING",
+     [AtomCurrentTag]   = "_WMFS_CURRENT_TAG",
+     [AtomActiveWindow] = "_NET_ACTIVE_WINDOW",
+};
+
+static Display *dpy;
+static Window root, barrier;
+static Atom atom[AtomLast];
+static int wmpid = -1;
+
+struct measure
+{
+     long *v;
+     int n;
+};
+
+static long
+now_us(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+
+     return (ts.tv_sec * 1000000L) + (ts.tv_nsec / 1000);
+}
+
+/* utime + stime of wmfs process in ms, -1 if unknown */
+static long
+wm_cpu_ms(void)
+{
+     char path[64], buf[1024], *p;
+     unsigned long ut, st;
+     FILE *f;
+
+     if(wmpid <= 0)
+          return -1;
+
+     snprintf(path, sizeof(path), "/proc/%d/stat", wmpid);
+
+     if(!(f = fopen(path, "r")))
+          return -1;
+
+     p = fgets(buf, sizeof(buf), f);
+     fclose(f);
+
+     /* Skip "pid (comm)", comm can contain spaces */
+     if(!p || !(p = strrchr(buf, ')'))
+        || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &ut, &st) != 2)
+          return -1;
+
+     return (long)((ut + st) * 1000 / sysconf(_SC_CLK_TCK));
+}
+
+static int
+cmp_long(const void *a, const void *b)
+{
+     long x = *(const long*)a, y = *(const long*)b;
+
+     return (x > y) - (x < y);
+}
+
+static void
+report(const char *name, struct measure *m, long cpu)
+{
+     long sum = 0;
+     int i;
+
+     qsort(m->v, m->n, sizeof(long), cmp_long);
+
+     for(i = 0; i < m->n; ++i)
+          sum += m->v[i];
+
+     printf("{\"bench\": \"%s\", \"n\": %d", name, m->n);
+
+     if(m->n)
+          printf(", \"avg_us\": %ld, \"min_us\": %ld, \"p50_us\": %ld, \"p95_us\": %ld, \"max_us\": %ld",
+                 sum / m->n, m->v[0], m->v[m->n / 2], m->v[(m->n * 95) / 100], m->v[m->n - 1]);
+
+     printf(", \"wm_cpu_ms\": %ld}\n", cpu);
+     fflush(stdout);
+
+     m->n = 0;
+}
+
+/* Wait for an event matching type/window/atom, with a timeout */
+static bool
+wait_event(int type, Window w, Atom a, bool synthetic, XEvent *ev)
+{
+     long end = now_us() + TIMEOUT_US;
+
+     while(now_us() < end)
+     {
+          while(XPending(dpy))
+          {
+               XNextEvent(dpy, ev);
+
+               if(ev->type != type || (w != None && ev->xany.window != w))
+                    continue;
+               if(type == PropertyNotify && ev->xproperty.atom != a)
+                    continue;
+               if(synthetic && !ev->xany.send_event)
+                    continue;
+
+               return true;
+          }
+
+          usleep(50);
+     }
+
+     fprintf(stderr, "xbench: timeout waiting for event %d\n", type);
+
+     return false;
+}
+
+/*
+ * wmfs handles events in order and forwards the ConfigureRequest of an
+ * unmanaged window as is: a border width changed at each barrier comes
+ * back only once every previous request was handled.  Replies to the
+ * requests of a storm can arrive late, so the marker is checked in the
+ * event.  A second round trip lets wmfs run the redraws it defers to
+ * the end of an events batch.
+ */
+static void
+wm_barrier(void)
+{
+     static int mark = 0;
+     XEvent ev;
+     XWindowChanges wc;
+     int i;
+
+     for(i = 0; i < 2; ++i)
+     {
+          /* Drop events of previous requests */
+          XSync(dpy, False);
+          while(XPending(dpy))
+               XNextEvent(dpy, &ev);
+
+          wc.border_width = mark = (mark % 100) + 1;
+
+          XConfigureWindow(dpy, barrier, CWBorderWidth, &wc);
+          XFlush(dpy);
+
+          while(wait_event(ConfigureNotify, barrier, None, false, &ev)
+                && ev.xconfigure.border_width != mark);
+     }
+}
+
+/* Same as wmfs -c <func> <cmd> */
+static void
+wm_uicb(const char *func, const char *cmd)
+{
+     XClientMessageEvent e =
+     {
+          .type         = ClientMessage,
+          .message_type = atom[AtomFunction],
+          .window       = root,
+          .format       = 32,
+          .data.l[4]    = true
+     };
+
+     XChangeProperty(dpy, root, atom[AtomFunction], atom[AtomUtf8], 8,
+                     PropModeReplace, (unsigned char*)func, strlen(func));
+     XChangeProperty(dpy, root, atom[AtomCmd], atom[AtomUtf8], 8,
+                     PropModeReplace, (unsigned char*)cmd, strlen(cmd));
+
+     XSendEvent(dpy, root, False, StructureNotifyMask, (XEvent*)&e);
+     XFlush(dpy);
+}
+
+static void
+wait_wm(void)
+{
+     long end = now_us() + TIMEOUT_US;
+     unsigned char *data = NULL;
+     unsigned long n, il;
+     Atom rt;
+     int rf;
+
+     while(now_us() < end)
+     {
+          if(XGetWindowProperty(dpy, root, atom[AtomRunning], 0, 1, False, XA_CARDINAL,
+                                &rt, &rf, &n, &il, &data) == Success && data)
+          {
+               XFree(data);
+               return;
+          }
+
+          usleep(10000);
+     }
+
+     fprintf(stderr, "xbench: wmfs is not running\n");
+     exit(EXIT_FAILURE);
+}
+
+static Window
+win_new(void)
+{
+     XSetWindowAttributes at = { .event_mask = StructureNotifyMask };
+
+     return XCreateWindow(dpy, root, 0, 0, 100, 100, 0, CopyFromParent,
+                          InputOutput, CopyFromParent, CWEventMask, &at);
+}
+
+/* Map N windows one by one, time until wmfs maps the frame and window */
+static void
+bench_map(Window *w, int n, struct measure *m)
+{
+     XEvent ev;
+     long t, cpu = wm_cpu_ms();
+     int i;
+
+     for(i = 0; i < n; ++i)
+     {
+          w[i] = win_new();
+          XStoreName(dpy, w[i], "xbench");
+
+          t = now_us();
+          XMapWindow(dpy, w[i]);
+          XFlush(dpy);
+
+          if(wait_event(MapNotify, w[i], None, false, &ev))
+               m->v[m->n++] = now_us() - t;
+     }
+
+     report("map_to_tiled", m, wm_cpu_ms() - cpu);
+}
+
+/* Title storm: k WM_NAME changes per window, time until all are handled */
+static void
+bench_title(Window *w, int n, int k, struct measure *m)
+{
+     char name[64];
+     long t, cpu = wm_cpu_ms();
+     int i, j;
+
+     t = now_us();
+
+     for(j = 0; j < k; ++j)
+          for(i = 0; i < n; ++i)
+          {
+               snprintf(name, sizeof(name), "xbench title %d", j);
+               XStoreName(dpy, w[i], name);
+          }
+
+     wm_barrier();
+     m->v[m->n++] = now_us() - t;
+
+     report("title_storm", m, wm_cpu_ms() - cpu);
+}
+
+/* ConfigureRequest storm, as a resizing client would do */
+static void
+bench_configure(Window *w, int n, int k, struct measure *m)
+{
+     long t, cpu = wm_cpu_ms();
+     int i, j;
+
+     t = now_us();
+
+     for(j = 0; j < k; ++j)
+          for(i = 0; i < n; ++i)
+               XResizeWindow(dpy, w[i], 100 + j, 100 + j);
+
+     wm_barrier();
+     m->v[m->n++] = now_us() - t;
+
+     report("configure_storm", m, wm_cpu_ms() - cpu);
+}
+
+/* Tag switch through _WMFS_FUNCTION, time until _WMFS_CURRENT_TAG update */
+static void
+bench_tag(int k, struct measure *m)
+{
+     XEvent ev;
+     char tag[8];
+     long t, cpu = wm_cpu_ms();
+     int j;
+
+     for(j = 0; j < k; ++j)
+     {
+          /* Tags are 1..3 in bench/wmfsrc, switch between 2 and 1 */
+          snprintf(tag, sizeof(tag), "%d", 1 - (j & 1));
+
+          t = now_us();
+          wm_uicb("tag_set", tag);
+
+          if(wait_event(PropertyNotify, root, atom[AtomCurrentTag], false, &ev))
+               m->v[m->n++] = now_us() - t;
+     }
+
+     /* Back to first tag */
+     wm_uicb("tag_set", "0");
+     wait_event(PropertyNotify, root, atom[AtomCurrentTag], false, &ev);
+
+     report("tag_switch", m, wm_cpu_ms() - cpu);
+}
+
+/* Keypress bound to client_focus_next, time until _NET_ACTIVE_WINDOW update */
+static void
+bench_key(int k, struct measure *m)
+{
+     XEvent ev;
+     XKeyEvent ke =
+     {
+          .type        = KeyPress,
+          .root        = root,
+          .window      = root,
+          .subwindow   = None,
+          .time        = CurrentTime,
+          .same_screen = True,
+          .state       = ControlMask,
+          .keycode     = XKeysymToKeycode(dpy, XK_F12)
+     };
+     long t, cpu = wm_cpu_ms();
+     int j;
+
+     for(j = 0; j < k; ++j)
+     {
+          t = now_us();
+          XSendEvent(dpy, root, False, KeyPressMask, (XEvent*)&ke);
+          XFlush(dpy);
+
+          if(wait_event(PropertyNotify, root, atom[AtomActiveWindow], false, &ev))
+               m->v[m->n++] = now_us() - t;
+     }
+
+     report("key_to_focus", m, wm_cpu_ms() - cpu);
+}
+
+/* Status strings push, with sequences */
+static void
+bench_status(int k, struct measure *m)
+{
+     char status[256];
+     long t, cpu = wm_cpu_ms();
+     int j;
+
+     t = now_us();
+
+     for(j = 0; j < k; ++j)
+     {
+          snprintf(status, sizeof(status),
+                   "bench ^s[left;#AABBAA;cpu %d%%] ^p[right;80;10;1;%d;100;#223322;#AABBAA]"
+                   " ^g[right;60;14;%d;100;#223322;#AABBAA;g1]",
+                   j % 100, j % 100, (j * 7) % 100);
+          wm_uicb("status", status);
+     }
+
+     wm_barrier();
+     m->v[m->n++] = now_us() - t;
+
+     report("status_push", m, wm_cpu_ms() - cpu);
+}
+
+/* Unmap and destroy every window, time until all are unmanaged */
+static void
+bench_unmap(Window *w, int n, struct measure *m)
+{
+     XEvent ev;
+     long t, cpu = wm_cpu_ms();
+     int i;
+
+     for(i = 0; i < n; ++i)
+     {
+          t = now_us();
+          XDestroyWindow(dpy, w[i]);
+          XFlush(dpy);
+
+          if(wait_event(DestroyNotify, w[i], None, false, &ev))
+               m->v[m->n++] = now_us() - t;
+     }
+
+     report("destroy", m, wm_cpu_ms() - cpu);
+}
+
+int
+main(int argc, char **argv)
+{
+     struct measure m;
+     Window *w;
+     int i, n = 20, k = 50;
+
+     while((i = getopt(argc, argv, "n:k:p:h")) != -1)
+     {
+          switch(i)
+          {
+               case 'n': n = atoi(optarg); break;
+               case 'k': k = atoi(optarg); break;
+               case 'p': wmpid = atoi(optarg); break;
+               default:
+                    fprintf(stderr, "usage: %s [-n windows] [-k iterations] [-p wmfs pid]\n", argv[0]);
+                    exit(EXIT_FAILURE);
+          }
+     }
+
+     if(n < 1 || k < 1)
+          exit(EXIT_FAILURE);
+
+     if(!(dpy = XOpenDisplay(NULL)))
+     {
+          fprintf(stderr, "%s: Can't open X server\n", argv[0]);
+          exit(EXIT_FAILURE);
+     }
+
+     root = DefaultRootWindow(dpy);
+     XInternAtoms(dpy, atom_name, AtomLast, False, atom);
+     XSelectInput(dpy, root, PropertyChangeMask);
+
+     wait_wm();
+
+     /* Never mapped, see wm_barrier() */
+     barrier = win_new();
+
+     w = calloc(n, sizeof(Window));
+     m.v = calloc((n > k ? n : k) + 1, sizeof(long));
+     m.n = 0;
+
+     wm_uicb("stats_reset", "");
+
+     bench_map(w, n, &m);
+     bench_title(w, n, k, &m);
+     bench_configure(w, n, k, &m);
+     bench_tag(k, &m);
+     bench_key(k, &m);
+     bench_status(k, &m);
+     bench_unmap(w, n, &m);
+
+     free(m.v);
+     free(w);
+
+     XCloseDisplay(dpy);
+
+     return 0;
+}
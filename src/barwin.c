@@ -6,6 +6,182 @@
 #include "wmfs.h"
 #include "barwin.h"
 #include "util.h"
+#include "winmap.h"
+
+#define PIXPOOL_MAX      (16) /* Free pixmaps kept for reuse */
+#define PIXMAP_HCLASS(h) (((h) + 7) & ~7)
+
+/*
+ * Back buffers are pooled by (depth, size class): widths are rounded
+ * to a power of 2 and heights to a multiple of 8, and a barwin pixmap
+ * only grows, b->geo holding the logical size.  Resizing a titlebar
+ * or a status element is then free most of the time, and a released
+ * pixmap is taken back by the next barwin of the same class.
+ */
+static int
+pixmap_wclass(int w)
+{
+     int c = 32;
+
+     while(c < w)
+          c <<= 1;
+
+     return c;
+}
+
+static struct pixmap*
+pixmap_get(int depth, int w, int h)
+{
+     struct pixmap *p;
+
+     w = pixmap_wclass(w);
+     h = PIXMAP_HCLASS(h);
+
+     SLIST_FOREACH(p, &W->pixpool.free, next)
+          if(p->depth == depth && p->w == w && p->h == h)
+          {
+               SLIST_REMOVE(&W->pixpool.free, p, pixmap, next);
+               --W->pixpool.nfree;
+               ++W->pixpool.reused;
+
+               return p;
+          }
+
+     p = xcalloc(1, sizeof(struct pixmap));
+     p->p = XCreatePixmap(W->dpy, W->root, w, h, depth);
+     p->depth = depth;
+     p->w = w;
+     p->h = h;
+
+     ++W->pixpool.created;
+
+     return p;
+}
+
+static void
+pixmap_destroy(struct pixmap *p)
+{
+     XFreePixmap(W->dpy, p->p);
+     free(p);
+}
+
+static void
+pixmap_release(struct pixmap *p)
+{
+     struct pixmap *l;
+
+     SLIST_INSERT_HEAD(&W->pixpool.free, p, next);
+
+     /* Drop the least recently released one */
+     if(++W->pixpool.nfree > PIXPOOL_MAX)
+     {
+          for(l = p; SLIST_NEXT(l, next); l = SLIST_NEXT(l, next));
+
+          SLIST_REMOVE(&W->pixpool.free, l, pixmap, next);
+          --W->pixpool.nfree;
+          pixmap_destroy(l);
+     }
+}
+
+/*
+ * Titlebars are drawn and copied to their window at once, so all
+ * titlebars of a height class draw in one scratch pixmap.
+ */
+static struct pixmap*
+pixmap_scratch(int depth, int h)
+{
+     struct pixmap *p;
+
+     SLIST_FOREACH(p, &W->pixpool.scratch, next)
+          if(p->depth == depth && p->h == PIXMAP_HCLASS(h))
+          {
+               ++p->refs;
+               return p;
+          }
+
+     p = pixmap_get(depth, 1, h);
+     p->refs = 1;
+
+     SLIST_INSERT_HEAD(&W->pixpool.scratch, p, next);
+
+     return p;
+}
+
+static void
+pixmap_scratch_unref(struct pixmap *p)
+{
+     if(--p->refs > 0)
+          return;
+
+     SLIST_REMOVE(&W->pixpool.scratch, p, pixmap, next);
+     p->refs = 0;
+     pixmap_release(p);
+}
+
+/* Make the back buffer of b large enough for w x h */
+static void
+barwin_pixmap(struct barwin *b, int w, int h)
+{
+     struct pixmap *p = b->pix;
+     struct barwin *bb;
+     int depth;
+
+     if(!p || (w <= p->w && h <= p->h))
+          return;
+
+     if(b->flags & BARWIN_SCRATCH)
+     {
+          if(PIXMAP_HCLASS(h) != p->h)
+          {
+               depth = p->depth;
+               pixmap_scratch_unref(p);
+               p = b->pix = pixmap_scratch(depth, h);
+
+               if(w <= p->w)
+               {
+                    b->dr = p->p;
+                    return;
+               }
+          }
+
+          /* Grow the shared pixmap, every titlebar using it follows */
+          XFreePixmap(W->dpy, p->p);
+          p->w = pixmap_wclass(w);
+          p->p = XCreatePixmap(W->dpy, W->root, p->w, p->h, p->depth);
+
+          ++W->pixpool.created;
+
+          SLIST_FOREACH(bb, &W->h.barwin, next)
+               if(bb->pix == p)
+                    bb->dr = p->p;
+
+          return;
+     }
+
+     b->pix = pixmap_get(p->depth, MAX(w, p->w), MAX(h, p->h));
+     b->dr = b->pix->p;
+
+     pixmap_release(p);
+}
+
+/** Release the back buffer of a barwin, for barwins never drawn
+ * \param b barwin pointer
+ */
+void
+barwin_drop_pixmap(struct barwin *b)
+{
+     if(!b->pix)
+          return;
+
+     if(b->flags & BARWIN_SCRATCH)
+          pixmap_scratch_unref(b->pix);
+     else
+          pixmap_release(b->pix);
+
+     b->flags &= ~BARWIN_SCRATCH;
+     b->pix = NULL;
+     b->dr = None;
+}
 
 /** Create a barwin
  * \param parent Parent window of the BarWindow
@@ -40,7 +216,8 @@ barwin_new(Window parent, int x, int y, int w, int h, Color fg, Color bg, bool e
                             BARWIN_WINCW,
                             &at);
 
-     b->dr = XCreatePixmap(W->dpy, parent, w, h, W->xdepth);
+     b->pix = pixmap_get(W->xdepth, w, h);
+     b->dr = b->pix->p;
 
      /* Property */
      b->geo.x = x;
@@ -55,6 +232,7 @@ barwin_new(Window parent, int x, int y, int w, int h, Color fg, Color bg, bool e
 
      /* Attach */
      SLIST_INSERT_HEAD(&W->h.barwin, b, next);
+     winmap_add(b->win, WinBarwin, b);
 
      return b;
 }
@@ -66,14 +244,30 @@ void
 barwin_remove(struct barwin *b)
 {
      SLIST_REMOVE(&W->h.barwin, b, barwin, next);
+     winmap_del(b->win, WinBarwin);
 
      XSelectInput(W->dpy, b->win, NoEventMask);
      XDestroyWindow(W->dpy, b->win);
-     XFreePixmap(W->dpy, b->dr);
+     barwin_drop_pixmap(b);
+
+     if(b->damage)
+          XDestroyRegion(b->damage);
 
      free(b);
 }
 
+/** Set window of a barwin, used to bind mousebinds on a foreign window
+ * \param b barwin pointer
+ * \param w Window
+ */
+void
+barwin_set_win(struct barwin *b, Window w)
+{
+     winmap_del(b->win, WinBarwin);
+     b->win = w;
+     winmap_add(w, WinBarwin, b);
+}
+
 /** Resize a barwin
  * \param bw barwin pointer
  * \param w Width
@@ -82,10 +276,8 @@ barwin_remove(struct barwin *b)
 void
 barwin_resize(struct barwin *b, int w, int h)
 {
-     /* Frame */
-     XFreePixmap(W->dpy, b->dr);
-
-     b->dr = XCreatePixmap(W->dpy, W->root, w, h, W->xdepth);
+     /* Pixmap only grows */
+     barwin_pixmap(b, w, h);
 
      b->geo.w = w;
      b->geo.h = h;
@@ -93,6 +285,119 @@ barwin_resize(struct barwin *b, int w, int h)
      XResizeWindow(W->dpy, b->win, w, h);
 }
 
+/** Draw a barwin in the shared scratch pixmap of its height, for
+ * barwins copied to their window right after being drawn
+ * \param b barwin pointer
+ */
+void
+barwin_set_scratch(struct barwin *b)
+{
+     if(b->flags & BARWIN_SCRATCH)
+          return;
+
+     barwin_drop_pixmap(b);
+
+     b->flags |= BARWIN_SCRATCH;
+     b->pix = pixmap_scratch(W->xdepth, b->geo.h);
+
+     /* Resize grows it if needed */
+     barwin_pixmap(b, b->geo.w, b->geo.h);
+     b->dr = b->pix->p;
+}
+
+/** Free the pixmaps pool
+ */
+void
+barwin_pool_free(void)
+{
+     struct pixmap *p;
+
+     while(!SLIST_EMPTY(&W->pixpool.free))
+     {
+          p = SLIST_FIRST(&W->pixpool.free);
+          SLIST_REMOVE_HEAD(&W->pixpool.free, next);
+          pixmap_destroy(p);
+     }
+
+     while(!SLIST_EMPTY(&W->pixpool.scratch))
+     {
+          p = SLIST_FIRST(&W->pixpool.scratch);
+          SLIST_REMOVE_HEAD(&W->pixpool.scratch, next);
+          pixmap_destroy(p);
+     }
+
+     W->pixpool.nfree = 0;
+}
+
+/** Mark an area of a barwin to copy to its window at next refresh
+ * \param b barwin pointer
+ * \param x X position
+ * \param y Y position
+ * \param w Width
+ * \param h Height
+ */
+void
+barwin_damage(struct barwin *b, int x, int y, int w, int h)
+{
+     XRectangle r;
+
+     /* Clip to logical size, pixmap may be larger */
+     if(x < 0)
+          w += x, x = 0;
+     if(y < 0)
+          h += y, y = 0;
+
+     w = MIN(w, b->geo.w - x);
+     h = MIN(h, b->geo.h - y);
+
+     if(w <= 0 || h <= 0)
+          return;
+
+     if(!b->damage)
+          b->damage = XCreateRegion();
+
+     r.x      = x;
+     r.y      = y;
+     r.width  = w;
+     r.height = h;
+
+     XUnionRectWithRegion(&r, b->damage, b->damage);
+}
+
+/** Copy damaged area of a barwin to its window, whole barwin if
+ * nothing was marked. Several rectangles are serviced by one copy of
+ * their bounding box, clipped to the damage region.
+ * \param b barwin pointer
+ */
+void
+barwin_refresh(struct barwin *b)
+{
+     XRectangle r;
+     bool clip;
+
+     if(!b->dr)
+          return;
+
+     if(!b->damage || XEmptyRegion(b->damage))
+     {
+          XCopyArea(W->dpy, b->dr, b->win, W->gc, 0, 0, b->geo.w, b->geo.h, 0, 0);
+          return;
+     }
+
+     XClipBox(b->damage, &r);
+
+     if((clip = (XRectInRegion(b->damage, r.x, r.y, r.width, r.height) != RectangleIn)))
+          XSetRegion(W->dpy, W->gc, b->damage);
+
+     XCopyArea(W->dpy, b->dr, b->win, W->gc, r.x, r.y, r.width, r.height, r.x, r.y);
+
+     if(clip)
+          XSetClipMask(W->dpy, W->gc, None);
+
+     /* Empty region, kept for next damage */
+     XSubtractRegion(b->damage, b->damage, b->damage);
+}
+
 /** Refresh the barwin Color
  * \param bw barwin pointer
 */
@@ -101,6 +406,8 @@ barwin_refresh_color(struct barwin *b)
 {
      XSetForeground(W->dpy, W->gc, b->bg);
      XFillRectangle(W->dpy, b->dr, W->gc, 0, 0, b->geo.w, b->geo.h);
+
+     barwin_damage(b, 0, 0, b->geo.w, b->geo.h);
 }
 
 
@@ -19,7 +19,6 @@
 #define barwin_delete_subwin(b) XDestroySubwindows(W->dpy, b->win)
 #define barwin_map_subwin(b)    XMapSubwindows(W->dpy, b->win)
 #define barwin_unmap_subwin(b)  XUnmapSubwindows(W->dpy, b->win)
-#define barwin_refresh(b)       XCopyArea(W->dpy, b->dr, b->win, W->gc, 0, 0, b->geo.w, b->geo.h, 0, 0)
 #define barwin_map(b)           XMapWindow(W->dpy, b->win);
 #define barwin_unmap(b)         XUnmapWindow(W->dpy, b->win);
 #define barwin_reparent(b, w)   XReparentWindow(W->dpy, b->win, w, 0, 0);
@@ -32,7 +31,13 @@ barwin_move(struct barwin *b, int x, int y)
 
 struct barwin* barwin_new(Window parent, int x, int y, int w, int h, Color fg, Color bg, bool entermask);
 void barwin_remove(struct barwin *b);
+void barwin_set_win(struct barwin *b, Window w);
 void barwin_resize(struct barwin *b, int w, int h);
+void barwin_damage(struct barwin *b, int x, int y, int w, int h);
+void barwin_refresh(struct barwin *b);
 void barwin_refresh_color(struct barwin *b);
+void barwin_set_scratch(struct barwin *b);
+void barwin_drop_pixmap(struct barwin *b);
+void barwin_pool_free(void);
 
 #endif /* BARWIN_H */
@@ -12,6 +12,7 @@
 #include "draw.h"
 #include "screen.h"
 #include "mouse.h"
+#include "winmap.h"
 
 #define CLIENT_RESIZE_DIR(D)                                    \
      void uicb_client_resize_##D(Uicb cmd)                      \
@@ -84,11 +85,11 @@ CLIENT_ACTION_LIST(swapsel, prev)
 CLIENT_ACTION_LIST(focus, next_tab)
 CLIENT_ACTION_LIST(focus, prev_tab)
 
-/** Send a ConfigureRequest event to the struct client
+/** Send a synthetic ConfigureNotify event to the struct client
  * \param c struct client pointer
 */
 void
-client_configure(struct client *c)
+client_send_configure(struct client *c)
 {
      XConfigureEvent ev =
      {
@@ -105,29 +106,40 @@ client_configure(struct client *c)
      };
 
      XSendEvent(W->dpy, c->win, false, StructureNotifyMask, (XEvent *)&ev);
-     XSync(W->dpy, false);
 }
 
-struct client*
-client_gb_win(Window w)
+/** Notify the struct client of its geometry, deferred until
+ *  layout_commit() inside a layout transaction
+ * \param c struct client pointer
+*/
+void
+client_configure(struct client *c)
 {
-     struct client *c = SLIST_FIRST(&W->h.client);
+     if(W->trans.depth)
+     {
+          if(!(c->flags & CLIENT_CONFIGURE))
+          {
+               c->flags |= CLIENT_CONFIGURE;
+               ++W->trans.pending;
+          }
 
-     while(c && c->win != w)
-          c = SLIST_NEXT(c, next);
+          return;
+     }
 
-     return c;
+     client_send_configure(c);
+     stats_xsync(W->dpy, false);
 }
 
 struct client*
-client_gb_frame(Window w)
+client_gb_win(Window w)
 {
-     struct client *c = SLIST_FIRST(&W->h.client);
-
-     while(c && c->frame != w)
-          c = SLIST_NEXT(c, next);
+     return winmap_get(w, WinClient);
+}
 
-     return c;
+struct client*
+client_gb_frame(Window w)
+{
+     return winmap_get(w, WinFrame);
 }
 
 struct client*
@@ -145,12 +157,7 @@ client_gb_pos(struct tag *t, int x, int y)
 struct client*
 client_gb_titlebar(Window w)
 {
-     struct client *c = SLIST_FIRST(&W->h.client);
-
-     while(c && c->titlebar && c->titlebar->win != w)
-          c = SLIST_NEXT(c, next);
-
-     return c;
+     return winmap_get(w, WinTitlebar);
 }
 
 /*
@@ -320,7 +327,7 @@ client_swap(struct client *c, enum position p)
                     break;
                }
 
-               XSync(W->dpy, False);
+               stats_xsync(W->dpy, False);
           }
           XNextEvent(W->dpy, &ev);
 
@@ -375,18 +382,28 @@ client_grabbuttons(struct client *c, bool focused)
      sctx->barwin = C->titlebar;                                   \
      status_copy_mousebind(sctx);                                  \
      status_render(sctx);
-void
-client_frame_update(struct client *c, struct colpair *cp)
+
+/*
+ * Draw titlebars of a frame; place them in the frame too if place is
+ * set, else only their content is drawn (expose of an already placed
+ * titlebar, reparent or map would expose it again).
+ */
+static void
+client_frame_draw(struct client *c, struct colpair *cp, bool place)
 {
      struct client *cc;
      struct status_ctx *sctx;
+     char buf[256], *title;
      int y, f, xt, rm, w, n = 1;
 
      if(c->flags & CLIENT_TABBED)
           c = c->tabmaster;
 
-     XSetWindowBackground(W->dpy, c->frame, cp->bg);
-     XClearWindow(W->dpy, c->frame);
+     if(place)
+     {
+          XSetWindowBackground(W->dpy, c->frame, cp->bg);
+          XClearWindow(W->dpy, c->frame);
+     }
 
      if(!c->titlebar || !c->title)
           return;
@@ -407,17 +424,21 @@ client_frame_update(struct client *c, struct colpair *cp)
 
      if(n == 1)
      {
-          w = draw_textw(c->theme, c->title);
+          title = draw_text_fit(c->theme, c->title, f - (c->border << 2), buf, sizeof(buf), &w);
           _XTEXT();
 
-          barwin_reparent(c->titlebar, c->frame);
-          barwin_move(c->titlebar, 0, 0);
-          barwin_resize(c->titlebar, f, c->tbarw);
+          if(place)
+          {
+               barwin_reparent(c->titlebar, c->frame);
+               barwin_move(c->titlebar, 0, 0);
+               barwin_resize(c->titlebar, f, c->tbarw);
+          }
+
           barwin_refresh_color(c->titlebar);
 
           _STATUSLINE(c, (cp == &c->scol));
 
-          draw_text(c->titlebar->dr, c->theme, xt, y, cp->fg, c->title);
+          draw_text(c->titlebar->dr, c->theme, xt, y, cp->fg, title);
           barwin_refresh(c->titlebar);
      }
      /* Tabbing case, multiple titlebar in frame */
@@ -425,21 +446,23 @@ client_frame_update(struct client *c, struct colpair *cp)
      {
           struct geo g = { f - 1, 0, 1, c->titlebar->geo.h };
           int x = c->border;
-          char *title;
 
           SLIST_FOREACH(cc, &c->tag->clients, tnext)
           {
-               title = (cc->title ? cc->title : "WMFS");
-               w = draw_textw(c->theme, title);
+               title = draw_text_fit(c->theme, (cc->title ? cc->title : "WMFS"),
+                                     f - (c->border << 2), buf, sizeof(buf), &w);
                _XTEXT();
 
                if(cc == c)
                {
-                    barwin_reparent(c->titlebar, c->frame);
-                    barwin_move(c->titlebar, x, 0);
-
                     _REMAINDER();
-                    barwin_resize(c->titlebar, f, c->tbarw);
+
+                    if(place)
+                    {
+                         barwin_reparent(c->titlebar, c->frame);
+                         barwin_move(c->titlebar, x, 0);
+                         barwin_resize(c->titlebar, f, c->tbarw);
+                    }
 
                     barwin_refresh_color(c->titlebar);
 
@@ -452,12 +475,15 @@ client_frame_update(struct client *c, struct colpair *cp)
                }
                if(cc->tabmaster == c)
                {
-                    barwin_reparent(cc->titlebar, c->frame);
-                    barwin_map(cc->titlebar);
-                    barwin_move(cc->titlebar, x, 1);
-
                     _REMAINDER();
-                    barwin_resize(cc->titlebar, f, c->tbarw - 2);
+
+                    if(place)
+                    {
+                         barwin_reparent(cc->titlebar, c->frame);
+                         barwin_map(cc->titlebar);
+                         barwin_move(cc->titlebar, x, 1);
+                         barwin_resize(cc->titlebar, f, c->tbarw - 2);
+                    }
 
                     barwin_refresh_color(cc->titlebar);
 
@@ -472,6 +498,24 @@ client_frame_update(struct client *c, struct colpair *cp)
      }
 }
 
+void
+client_frame_update(struct client *c, struct colpair *cp)
+{
+     client_frame_draw(c, cp, true);
+}
+
+/** Draw titlebars of a frame again, without moving them
+ * \param c struct client pointer
+ */
+void
+client_frame_redraw(struct client *c)
+{
+     if(c->flags & CLIENT_TABBED)
+          c = c->tabmaster;
+
+     client_frame_draw(c, CCOL(c), false);
+}
+
 void
 client_tab_focus(struct client *c)
 {
@@ -660,10 +704,10 @@ client_get_name(struct client *c)
      unsigned long ir, il;
 
      /* This one instead XFetchName for utf8 name support */
-     if(XGetWindowProperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 65536,
-                    False, W->net_atom[utf8_string], &rt, &rf, &ir, &il, (unsigned char**)&c->title) != Success)
-          XGetWindowProperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 65536,
-                             False, W->net_atom[utf8_string], &rt, &rf, &ir, &il, (unsigned char**)&c->title);
+     if(stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 65536,
+                          False, W->net_atom[utf8_string], &rt, &rf, &ir, &il, (unsigned char**)&c->title) != Success)
+          stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 65536,
+                                   False, W->net_atom[utf8_string], &rt, &rf, &ir, &il, (unsigned char**)&c->title);
 
      /* Still no title... */
      if(!c->title)
@@ -686,13 +730,13 @@ client_close(struct client *c)
      if(XGetWMProtocols(W->dpy, c->win, &atom, &proto) && atom)
      {
           while(proto--)
-               if(atom[proto] == ATOM("WM_DELETE_WINDOW"))
+               if(atom[proto] == W->net_atom[wm_delete_window])
                {
                     ev.type = ClientMessage;
                     ev.xclient.window = c->win;
-                    ev.xclient.message_type = ATOM("WM_PROTOCOLS");
+                    ev.xclient.message_type = W->net_atom[wm_protocols];
                     ev.xclient.format = 32;
-                    ev.xclient.data.l[0] = ATOM("WM_DELETE_WINDOW");
+                    ev.xclient.data.l[0] = W->net_atom[wm_delete_window];
                     ev.xclient.data.l[1] = CurrentTime;
 
                     XSendEvent(W->dpy, c->win, False, NoEventMask, &ev);
@@ -793,17 +837,20 @@ client_frame_new(struct client *c)
      /* Use a fake barwin only to store mousebinds of frame win */
      frameb = barwin_new(W->root, 0, 0, 1, 1, 0, 0, false);
      clientb = barwin_new(W->root, 0, 0, 1, 1, 0, 0, false);
+     barwin_drop_pixmap(frameb);
+     barwin_drop_pixmap(clientb);
+
+     c->frame = XCreateWindow(W->dpy, W->root,
+                              c->geo.x, c->geo.y,
+                              c->geo.w, c->geo.h,
+                              0, CopyFromParent,
+                              InputOutput,
+                              CopyFromParent,
+                              (CWOverrideRedirect | CWBackPixmap
+                               | CWBackPixel | CWEventMask), &at);
 
-     frameb->win =
-          c->frame = XCreateWindow(W->dpy, W->root,
-                                   c->geo.x, c->geo.y,
-                                   c->geo.w, c->geo.h,
-                                   0, CopyFromParent,
-                                   InputOutput,
-                                   CopyFromParent,
-                                   (CWOverrideRedirect | CWBackPixmap
-                                    | CWBackPixel | CWEventMask), &at);
-     clientb->win = c->win;
+     barwin_set_win(frameb, c->frame);
+     barwin_set_win(clientb, c->win);
 
      frameb->mousebinds = W->tmp_head.client;
      clientb->mousebinds = W->tmp_head.client;
@@ -813,6 +860,9 @@ client_frame_new(struct client *c)
           c->titlebar = barwin_new(c->frame, 0, 0, 1, c->tbarw,
                                    c->ncol.fg, c->ncol.bg, true);
 
+          /* Redrawn by client_frame_update on expose */
+          barwin_set_scratch(c->titlebar);
+
           c->titlebar->mousebinds = W->tmp_head.client;
      }
 
@@ -838,8 +888,8 @@ client_apply_rule(struct client *c)
      Status s = XGetClassHint(W->dpy, c->win, &xch);
 
      /* Get WM_WINDOW_ROLE */
-     if(XGetWindowProperty(W->dpy, c->win, ATOM("WM_WINDOW_ROLE"), 0L, 0x7FFFFFFFL, false,
-                           XA_STRING, &rf, &f, &n, &il, &data)
+     if(stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[wm_window_role], 0L, 0x7FFFFFFFL, false,
+                                 XA_STRING, &rf, &f, &n, &il, &data)
                == Success && data)
      {
           role = xstrdup((char*)data);
@@ -847,8 +897,8 @@ client_apply_rule(struct client *c)
      }
 
      /* Get _NET_WM_NAME */
-     if(XGetWindowProperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 0x77777777, false,
-                           W->net_atom[utf8_string], &rf, &f, &n, &il, &data)
+     if(stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[net_wm_name], 0, 0x77777777, false,
+                                 W->net_atom[utf8_string], &rf, &f, &n, &il, &data)
                == Success && data)
      {
           wmname = xstrdup((char*)data);
@@ -965,6 +1015,11 @@ client_new(Window w, XWindowAttributes *wa, bool scan)
      /* Attach */
      SLIST_INSERT_HEAD(&W->h.client, c, next);
 
+     winmap_add(c->win, WinClient, c);
+     winmap_add(c->frame, WinFrame, c);
+     if(c->titlebar)
+          winmap_add(c->titlebar->win, WinTitlebar, c);
+
      if(!scan)
      {
           client_get_name(c);
@@ -982,22 +1037,22 @@ client_update_props(struct client *c, Flags f)
 {
      if(f & CPROP_LOC)
      {
-          XChangeProperty(W->dpy, c->win, ATOM("_WMFS_TAG"), XA_CARDINAL, 32,
+          XChangeProperty(W->dpy, c->win, W->net_atom[wmfs_tag], XA_CARDINAL, 32,
                           PropModeReplace, (unsigned char*)&(c->tag->id), 1);
 
-          XChangeProperty(W->dpy, c->win, ATOM("_WMFS_SCREEN"), XA_CARDINAL, 32,
+          XChangeProperty(W->dpy, c->win, W->net_atom[wmfs_screen], XA_CARDINAL, 32,
                           PropModeReplace, (unsigned char*)&(c->screen->id), 1);
      }
 
      if(f & CPROP_FLAG)
-          XChangeProperty(W->dpy, c->win, ATOM("_WMFS_FLAGS"), XA_CARDINAL, 32,
+          XChangeProperty(W->dpy, c->win, W->net_atom[wmfs_flags], XA_CARDINAL, 32,
                           PropModeReplace, (unsigned char*)&(c->flags), 1);
 
      if(f & CPROP_GEO)
      {
           long g[4] = { (long)c->geo.x, (long)c->geo.y, (long)c->geo.w, (long)c->geo.h };
 
-          XChangeProperty(W->dpy, c->win, ATOM("_WMFS_GEO"), XA_CARDINAL, 32,
+          XChangeProperty(W->dpy, c->win, W->net_atom[wmfs_geo], XA_CARDINAL, 32,
                           PropModeReplace, (unsigned char*)g, 4);
 
      }
@@ -1005,7 +1060,7 @@ client_update_props(struct client *c, Flags f)
      if(f & CPROP_TAB)
      {
           Window w = (c->tabmaster ? c->tabmaster->win : 0);
-          XChangeProperty(W->dpy, c->win, ATOM("_WMFS_TABMASTER"), XA_WINDOW, 32,
+          XChangeProperty(W->dpy, c->win, W->net_atom[wmfs_tabmaster], XA_WINDOW, 32,
                           PropModeReplace, (unsigned char*)&w, 1);
      }
 }
@@ -1080,6 +1135,8 @@ client_winsize(struct client *c, struct geo *g)
 void
 client_moveresize(struct client *c, struct geo *g)
 {
+     bool changed = false;
+
      if(c->flags & CLIENT_TABBED)
           return;
 
@@ -1135,20 +1192,34 @@ client_moveresize(struct client *c, struct geo *g)
           c->rgeo.y += c->screen->ugeo.y;
      }
 
-     XMoveResizeWindow(W->dpy, c->frame,
-                       c->rgeo.x, c->rgeo.y,
-                       c->rgeo.w, c->rgeo.h);
+     c->flags &= ~CLIENT_DID_WINSIZE;
+
+     /* Skip request if geometry known by X didn't change */
+     if(!GEOCMP(c->rgeo, c->xgeo))
+     {
+          XMoveResizeWindow(W->dpy, c->frame,
+                            c->rgeo.x, c->rgeo.y,
+                            c->rgeo.w, c->rgeo.h);
+          c->xgeo = c->rgeo;
+          changed = true;
+     }
 
-     if(!(c->flags & CLIENT_FULLSCREEN))
+     if(!(c->flags & CLIENT_FULLSCREEN) && !GEOCMP(c->wgeo, c->xwgeo))
+     {
           XMoveResizeWindow(W->dpy, c->win,
                             c->wgeo.x, c->wgeo.y,
                             c->wgeo.w, c->wgeo.h);
-
-     c->flags &= ~CLIENT_DID_WINSIZE;
+          c->xwgeo = c->wgeo;
+          changed = true;
+     }
 
      client_frame_update(c, CCOL(c));
-     client_update_props(c, CPROP_GEO);
-     client_configure(c);
+
+     if(changed)
+     {
+          client_update_props(c, CPROP_GEO);
+          client_configure(c);
+     }
 }
 
 void
@@ -1260,11 +1331,15 @@ client_apply_tgeo(struct tag *t)
 {
      struct client *c;
 
+     layout_begin();
+
      FOREACH_NFCLIENT(c, &t->clients, tnext)
      {
           client_moveresize(c, &c->tgeo);
           c->flags &= ~CLIENT_FAC_APPLIED;
      }
+
+     layout_commit();
 }
 
 #define _REV_BORDER()                                           \
@@ -1335,7 +1410,7 @@ client_fac_resize(struct client *c, enum position p, int fac)
                     break;
                }
 
-               XSync(W->dpy, False);
+               stats_xsync(W->dpy, False);
           }
           XNextEvent(W->dpy, &ev);
 
@@ -1394,16 +1469,22 @@ client_remove(struct client *c)
      XReparentWindow(W->dpy, c->win, W->root, c->rgeo.x, c->rgeo.y);
      XUngrabButton(W->dpy, AnyButton, AnyModifier, c->win);
      ewmh_set_wm_state(c->win, WithdrawnState);
-     XSync(W->dpy, false);
+     stats_xsync(W->dpy, false);
      XSetErrorHandler(wmfs_error_handler);
      XUngrabServer(W->dpy);
 
      SLIST_REMOVE(&W->h.client, c, client, next);
      tag_client(NULL, c);
 
+     winmap_del(c->win, WinClient);
+     winmap_del(c->frame, WinFrame);
+
      /* Remove frame */
      if(c->titlebar)
+     {
+          winmap_del(c->titlebar->win, WinTitlebar);
           barwin_remove(c->titlebar);
+     }
      XDestroyWindow(W->dpy, c->frame);
 
      free(c);
@@ -18,6 +18,7 @@
      SLIST_FOREACH(V, H, F)       \
      if(!(V->flags & CLIENT_FREE))
 
+void client_send_configure(struct client *c);
 void client_configure(struct client *c);
 struct client *client_gb_win(Window w);
 struct client *client_gb_frame(Window w);
@@ -28,6 +29,7 @@ void client_swap2(struct client *c1, struct client *c2);
 void client_swap(struct client *c, enum position p);
 #define CCOL(c) (c == W->client ? &c->scol : &c->ncol)
 void client_frame_update(struct client *c, struct colpair *cp);
+void client_frame_redraw(struct client *c);
 void client_tab_pull(struct client *c);
 void _client_tab(struct client *c, struct client *cm);
 void client_tab_focus(struct client *c);
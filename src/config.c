@@ -11,6 +11,10 @@
 #include "infobar.h"
 #include "util.h"
 #include "status.h"
+#include "provider.h"
+#include "raster.h"
+#include "image.h"
+#include "draw.h"
 
 #define ISTRDUP(t, s)             \
      do {                         \
@@ -61,6 +65,7 @@ config_theme(void)
           ++n;
 
      SLIST_INIT(&W->h.theme);
+     SLIST_INIT(&W->h.font);
 
      /* [theme]*/
      for(i = 0; i < n; ++i)
@@ -69,7 +74,8 @@ config_theme(void)
 
           t->name = fetch_opt_first(ks[i], "default", "name").str;
 
-          wmfs_init_font(fetch_opt_first(ks[i], "fixed", "font").str, t);
+          t->font = font_new(fetch_opt_first(ks[i], "fixed", "font").str,
+                             !strcmp(fetch_opt_first(ks[i], "core", "font_backend").str, "xft"));
 
           /* bars */
           t->bars.fg    = color_atoh(fetch_opt_first(ks[i], "#CCCCCC", "bars_fg").str);
@@ -144,10 +150,11 @@ config_bars(void)
 {
      struct screen *s;
      struct theme *t;
-     size_t i, n;
-     struct conf_sec *sec, **ks;
-     int screenid;
-     char *name, *elem;
+     struct infobar *ib;
+     size_t i, j, n, ns;
+     struct conf_sec *sec, **ks, **sg;
+     int screenid, rate;
+     char *name, *elem, *tpl, *sgname, *sgtext;
      enum barpos pos = BarTop;
 
      /* [bars] */
@@ -163,10 +170,45 @@ config_bars(void)
           screenid = fetch_opt_first(ks[i], "-1", "screen").num;
           t = name_to_theme(fetch_opt_first(ks[i], "default", "theme").str);
           pos = fetch_opt_first(ks[i], "0", "position").num;
+          tpl = fetch_opt_first(ks[i], "", "status_template").str;
+          rate = fetch_opt_first(ks[i], "0", "rate").num;
 
           SLIST_FOREACH(s, &W->h.screen, next)
                if(screenid == s->id || screenid == -1)
-                    infobar_new(s, name, t, pos, elem);
+               {
+                    ib = infobar_new(s, name, t, pos, elem);
+                    ib->rate = MAX(rate, 0);
+
+                    if(tpl)
+                    {
+                         ib->status_template = xstrdup(tpl);
+                         provider_status_update(ib);
+                    }
+
+                    /* [segment] */
+                    if((sg = fetch_section(ks[i], "segment")))
+                    {
+                         ns = fetch_section_count(sg);
+
+                         for(j = 0; j < ns; ++j)
+                         {
+                              if(!(sgname = fetch_opt_first(sg[j], "", "name").str))
+                                   continue;
+
+                              sgtext = fetch_opt_first(sg[j], "", "text").str;
+
+                              infobar_segment_new(ib, sgname,
+                                                  fetch_opt_first(sg[j], "100", "width").num,
+                                                  str_to_position(fetch_opt_first(sg[j], "right", "align").str),
+                                                  sgtext);
+                         }
+
+                         if(ns)
+                              infobar_elem_reinit(ib);
+
+                         free(sg);
+                    }
+               }
      }
 
      free(ks);
@@ -371,6 +413,62 @@ config_keybind(void)
      free(ks);
 }
 
+static void
+config_provider(void)
+{
+     struct conf_sec *sec, **ks;
+     char *name, *type, *arg;
+     int n, i;
+
+     /* [providers] */
+     sec = fetch_section_first(NULL, "providers");
+     ks = fetch_section(sec, "provider");
+     n = fetch_section_count(ks);
+
+     SLIST_INIT(&W->h.provider);
+
+     /* [provider] */
+     for(i = 0; i < n; ++i)
+     {
+          name = fetch_opt_first(ks[i], "", "name").str;
+          type = fetch_opt_first(ks[i], "", "type").str;
+
+          if(!(arg = fetch_opt_first(ks[i], "", "arg").str))
+               arg = "";
+
+          if(!name || !type)
+          {
+               warnxl("provider without name or type");
+               continue;
+          }
+
+          provider_new(name, type, arg, fetch_opt_first(ks[i], "0", "interval").num);
+     }
+
+     free(ks);
+}
+
+static void
+config_misc(void)
+{
+     struct conf_sec *sec;
+
+     /* [misc] */
+     sec = fetch_section_first(NULL, "misc");
+
+     FLAGAPPLY(W->flags, fetch_opt_first(sec, "false", "input_priority").boolean, WMFS_INPUTPRIO);
+
+     if(fetch_opt_first(sec, "false", "stats").boolean)
+          stats_init();
+
+     if(fetch_opt_first(sec, "false", "raster").boolean)
+          raster_init();
+
+#ifdef HAVE_IMLIB2
+     image_init(fetch_opt_first(sec, "4096", "image_cache").num);
+#endif /* HAVE_IMLIB2 */
+}
+
 void
 config_init(void)
 {
@@ -383,10 +481,12 @@ config_init(void)
                errxl(1, "parsing default configuration file (%s) failed.", W->confpath);
      }
 
+     config_misc();
      config_theme();
      config_keybind();
      config_tag();
      config_client();
+     config_provider();
      config_bars();
      config_rule();
      config_launcher();
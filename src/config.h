@@ -85,6 +85,8 @@ static const struct { char *name; void (*func)(Uicb cmd); } uicb_list[] =
 
      /* Status */
      { "status" ,        uicb_status },
+     { "status_set",     uicb_status_set },
+     { "status_push",    uicb_status_push },
      { "status_surface", uicb_status_surface },
 
      /* Mouse */
@@ -102,6 +104,10 @@ static const struct { char *name; void (*func)(Uicb cmd); } uicb_list[] =
      /* Launcher */
      { "launcher", uicb_launcher },
 
+     /* Stats */
+     { "stats_dump",  uicb_stats_dump },
+     { "stats_reset", uicb_stats_reset },
+
      { NULL, NULL }
 };
 
@@ -0,0 +1,409 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#include <stdint.h>
+
+#include "draw.h"
+#include "util.h"
+
+#define TEXTW_CACHE_SIZE (512) /* Slots, power of 2 */
+#define TEXTW_MAXLEN     (512) /* Longer strings are not cached */
+#define ELLIPSIS         "..."
+
+/*
+ * Text widths cache: direct mapped, a new string replaces the one in
+ * its slot, so memory is bounded by TEXTW_CACHE_SIZE * TEXTW_MAXLEN.
+ */
+static struct textw textw_cache[TEXTW_CACHE_SIZE];
+
+#ifdef HAVE_XFT
+/*
+ * Xft backend: glyphs are rendered client side once and kept in
+ * server glyph sets by Xft, a string is a single XRender request.
+ * One XftDraw is retargeted to the drawable of each draw; it is
+ * created lazily, so the current clip is kept to be set on creation.
+ */
+static XftDraw *xftdraw = NULL;
+static Region xftclip = NULL;
+
+static XftDraw*
+draw_xft(Drawable d)
+{
+     if(!xftdraw)
+     {
+          xftdraw = XftDrawCreate(W->dpy, d, DefaultVisual(W->dpy, W->xscreen),
+                                  DefaultColormap(W->dpy, W->xscreen));
+
+          if(xftclip)
+               XftDrawSetClip(xftdraw, xftclip);
+     }
+     else if(XftDrawDrawable(xftdraw) != d)
+          XftDrawChange(xftdraw, d);
+
+     return xftdraw;
+}
+
+/* Color is a TrueColor pixel */
+static void
+draw_xftcolor(Color c, XftColor *xc)
+{
+     xc->pixel       = c;
+     xc->color.red   = ((c >> 16) & 0xff) * 0x101;
+     xc->color.green = ((c >> 8) & 0xff) * 0x101;
+     xc->color.blue  = (c & 0xff) * 0x101;
+     xc->color.alpha = 0xffff;
+}
+
+/* Keep a copy of clip (NULL to remove) and set it on XftDraw if any */
+static void
+draw_xft_clip(Region r)
+{
+     if(xftclip)
+     {
+          XDestroyRegion(xftclip);
+          xftclip = NULL;
+     }
+
+     if(r)
+     {
+          xftclip = XCreateRegion();
+          XUnionRegion(r, xftclip, xftclip);
+     }
+
+     if(xftdraw)
+          XftDrawSetClip(xftdraw, xftclip);
+}
+#endif /* HAVE_XFT */
+
+void
+draw_text_len(Drawable d, struct theme *t, int x, int y, Color fg, const char *str, int len)
+{
+     struct font *f = FONT(t);
+
+#ifdef HAVE_XFT
+     if(f->xft)
+     {
+          XftColor xc;
+
+          draw_xftcolor(fg, &xc);
+          XftDrawStringUtf8(draw_xft(d), &xc, f->xft, x, y, (const FcChar8*)str, len);
+
+          return;
+     }
+#endif /* HAVE_XFT */
+
+     XSetForeground(W->dpy, W->gc, fg);
+     XmbDrawString(W->dpy, d, f->fontset, W->gc, x, y, str, len);
+}
+
+void
+draw_text(Drawable d, struct theme *t, int x, int y, Color fg, const char *str)
+{
+     draw_text_len(d, t, x, y, fg, str, strlen(str));
+}
+
+/** Area painted by a string drawn at 0, 0 (baseline)
+ * \param t Theme of font
+ * \param str String
+ * \param len Length in bytes
+ * \param g Area return
+ */
+void
+draw_text_box(struct theme *t, const char *str, int len, struct geo *g)
+{
+     struct font *f = FONT(t);
+     XRectangle ink, log;
+
+#ifdef HAVE_XFT
+     if(f->xft)
+     {
+          XGlyphInfo gi;
+
+          XftTextExtentsUtf8(W->dpy, f->xft, (const FcChar8*)str, len, &gi);
+
+          ink.x = -gi.x;
+          ink.y = -gi.y;
+          ink.width  = gi.width;
+          ink.height = gi.height;
+
+          log.x = 0;
+          log.y = -f->as;
+          log.width  = gi.xOff;
+          log.height = f->height;
+     }
+     else
+#endif /* HAVE_XFT */
+          XmbTextExtents(f->fontset, str, len, &ink, &log);
+
+     /* Union of ink and logical extents */
+     g->x = MIN(ink.x, log.x);
+     g->y = MIN(ink.y, log.y);
+     g->w = MAX(ink.x + ink.width, log.x + log.width) - g->x;
+     g->h = MAX(ink.y + ink.height, log.y + log.height) - g->y;
+}
+
+/** Clip text and X primitives drawn with W->gc
+ * \param r Clip rectangle, NULL to remove clip
+ */
+void
+draw_set_clip(XRectangle *r)
+{
+     if(r)
+          XSetClipRectangles(W->dpy, W->gc, 0, 0, r, 1, Unsorted);
+     else
+          XSetClipMask(W->dpy, W->gc, None);
+
+#ifdef HAVE_XFT
+     if(r)
+     {
+          Region rg = XCreateRegion();
+
+          XUnionRectWithRegion(r, rg, rg);
+          draw_xft_clip(rg);
+          XDestroyRegion(rg);
+     }
+     else
+          draw_xft_clip(NULL);
+#endif /* HAVE_XFT */
+}
+
+/** Clip text and X primitives drawn with W->gc to a region
+ * \param r Clip region, see draw_set_clip to remove it
+ */
+void
+draw_set_clip_region(Region r)
+{
+     XSetRegion(W->dpy, W->gc, r);
+
+#ifdef HAVE_XFT
+     draw_xft_clip(r);
+#endif /* HAVE_XFT */
+}
+
+static unsigned int
+textw_hash(void *font, const char *str, int len)
+{
+     unsigned int h = 2166136261u ^ (unsigned int)(uintptr_t)font;
+
+     while(len--)
+          h = (h ^ (unsigned char)*str++) * 16777619u;
+
+     return h;
+}
+
+static unsigned short
+draw_textw_measure(struct theme *t, const char *str, int len)
+{
+     struct font *f = FONT(t);
+     XRectangle r;
+
+#ifdef HAVE_XFT
+     if(f->xft)
+     {
+          XGlyphInfo gi;
+
+          XftTextExtentsUtf8(W->dpy, f->xft, (const FcChar8*)str, len, &gi);
+
+          return gi.xOff;
+     }
+#endif /* HAVE_XFT */
+
+     XmbTextExtents(f->fontset, str, len, NULL, &r);
+
+     return r.width;
+}
+
+/** Width of the len first bytes of str, cached by (fontset, string)
+ * \param t Theme of font
+ * \param str String
+ * \param len Length in bytes, must end on a character
+ * \return width in pixels
+ */
+unsigned short
+draw_textw_len(struct theme *t, const char *str, int len)
+{
+     struct textw *tw;
+     void *font = t->font;
+     unsigned int h;
+
+     if(len > TEXTW_MAXLEN)
+          return draw_textw_measure(t, str, len);
+
+     h  = textw_hash(font, str, len);
+     tw = &textw_cache[h & (TEXTW_CACHE_SIZE - 1)];
+
+     if(tw->font == font && tw->hash == h
+        && tw->len == len && !memcmp(tw->str, str, len))
+          return tw->w;
+
+     if(!tw->str)
+          tw->str = xmalloc(TEXTW_MAXLEN, 1);
+
+     memcpy(tw->str, str, len);
+     tw->font = font;
+     tw->hash = h;
+     tw->len  = len;
+     tw->w    = draw_textw_measure(t, str, len);
+
+     return tw->w;
+}
+
+unsigned short
+draw_textw(struct theme *t, const char *str)
+{
+     return draw_textw_len(t, str, strlen(str));
+}
+
+/** Font of the cache, shared by themes with same name, backend and
+ * locale; opened only at first use through FONT()
+ * \param name Font name
+ * \param xft Use Xft backend
+ * \return font with a new reference
+ */
+struct font*
+font_new(const char *name, bool xft)
+{
+     struct font *f;
+     const char *locale = setlocale(LC_CTYPE, NULL);
+
+     if(!locale)
+          locale = "C";
+
+     SLIST_FOREACH(f, &W->h.font, next)
+          if(f->usexft == xft && !strcmp(f->name, name) && !strcmp(f->locale, locale))
+          {
+               ++f->refs;
+               return f;
+          }
+
+     f = xcalloc(1, sizeof(struct font));
+     f->name   = xstrdup(name);
+     f->locale = xstrdup(locale);
+     f->usexft = xft;
+     f->refs   = 1;
+
+     SLIST_INSERT_HEAD(&W->h.font, f, next);
+
+     return f;
+}
+
+struct font*
+font_load(struct font *f)
+{
+     if(!f->loaded)
+          wmfs_init_font(f);
+
+     return f;
+}
+
+void
+font_release(struct font *f)
+{
+     if(--f->refs > 0)
+          return;
+
+     SLIST_REMOVE(&W->h.font, f, font, next);
+
+     if(f->loaded)
+     {
+#ifdef HAVE_XFT
+          if(f->xft)
+               XftFontClose(W->dpy, f->xft);
+          else
+#endif /* HAVE_XFT */
+               XFreeFontSet(W->dpy, f->fontset);
+     }
+
+     free(f->name);
+     free(f->locale);
+     free(f);
+}
+
+/** Fit a string in maxw pixels, cut with an ellipsis if needed.
+ * Longest prefix is found by binary search on character boundaries,
+ * so only O(log n) prefix widths are measured.
+ * \param t Theme of font
+ * \param str String
+ * \param maxw Available width
+ * \param buf Buffer for the cut string
+ * \param size Size of buf
+ * \param w Width of returned string
+ * \return str if it fits, buf else
+ */
+char*
+draw_text_fit(struct theme *t, char *str, int maxw, char *buf, size_t size, int *w)
+{
+     static int *cut = NULL;
+     static int ncut = 0;
+     int len = strlen(str), ew, i, n, lo, hi, mid;
+
+     if((*w = draw_textw_len(t, str, len)) <= maxw || size <= sizeof(ELLIPSIS))
+          return str;
+
+     ew = draw_textw_len(t, ELLIPSIS, sizeof(ELLIPSIS) - 1);
+
+     /*
+      * Cut points: starts of UTF-8 characters, within buf;
+      * str[len] is the NUL byte only when len is not clamped
+      */
+     len = MIN(len, (int)(size - sizeof(ELLIPSIS)));
+
+     if(ncut < len + 1)
+          cut = xrealloc(cut, (ncut = len + 1), sizeof(int));
+
+     for(i = 1, n = 0; i <= len; ++i)
+          if((str[i] & 0xc0) != 0x80)
+               cut[n++] = i;
+
+     /* Longest prefix that fits, -1 if none */
+     for(lo = -1, hi = n - 1; lo < hi;)
+     {
+          mid = (lo + hi + 1) >> 1;
+
+          if(draw_textw_len(t, str, cut[mid]) + ew <= maxw)
+               lo = mid;
+          else
+               hi = mid - 1;
+     }
+
+     n = (lo < 0 ? 0 : cut[lo]);
+
+     memcpy(buf, str, n);
+     memcpy(buf + n, ELLIPSIS, sizeof(ELLIPSIS));
+
+     *w = (n ? draw_textw_len(t, str, n) : 0) + ew;
+
+     return buf;
+}
+
+/** Forget cached widths, to call when fonts are freed
+ */
+void
+draw_text_flush(void)
+{
+     int i;
+
+     for(i = 0; i < TEXTW_CACHE_SIZE; ++i)
+     {
+          free(textw_cache[i].str);
+          memset(&textw_cache[i], 0, sizeof(struct textw));
+     }
+}
+
+void
+draw_free(void)
+{
+     draw_text_flush();
+
+#ifdef HAVE_XFT
+     if(xftdraw)
+     {
+          XftDrawDestroy(xftdraw);
+          xftdraw = NULL;
+     }
+
+     draw_xft_clip(NULL);
+#endif /* HAVE_XFT */
+}
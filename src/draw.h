@@ -10,24 +10,14 @@
 #include <string.h>
 #include <X11/Xlib.h>
 
-#ifdef HAVE_IMLIB2
-#include <Imlib2.h>
-#endif /* HAVE_IMLIB2 */
-
 #include "wmfs.h"
 #include "config.h"
 #include "screen.h"
 
-#define TEXTY(t, w) ((t->font.height - t->font.de) + ((w - t->font.height) >> 1))
+#define FONT(t)     ((t)->font->loaded ? (t)->font : font_load((t)->font))
+#define TEXTY(t, w) ((FONT(t)->height - FONT(t)->de) + ((w - FONT(t)->height) >> 1))
 #define PAD (8)
 
-static inline void
-draw_text(Drawable d, struct theme *t, int x, int y, Color fg, const char *str)
-{
-     XSetForeground(W->dpy, W->gc, fg);
-     XmbDrawString(W->dpy, d, t->font.fontset, W->gc, x, y, str, strlen(str));
-}
-
 static inline void
 draw_rect(Drawable d, struct geo *g, Color bg)
 {
@@ -35,37 +25,6 @@ draw_rect(Drawable d, struct geo *g, Color bg)
      XFillRectangle(W->dpy, d, W->gc, g->x, g->y, g->w, g->h);
 }
 
-#ifdef HAVE_IMLIB2
-
-/*
- * Draw image on drawable with g geo
- * Require that the image was loaded with draw_image_load()
- */
-static inline void
-draw_image(Drawable d, struct geo *g)
-{
-     imlib_context_set_drawable(d);
-     imlib_render_image_on_drawable_at_size(g->x, g->y, g->w, g->h);
-     imlib_free_image();
-}
-
-/*
- * Load image, set it in imlib context, and return
- * width & height as argument 2 & 3
- */
-static inline void
-draw_image_load(char *path, int *w, int *h)
-{
-     Imlib_Image image = imlib_load_image(path);
-
-     imlib_context_set_image(image);
-
-     *w = imlib_image_get_width();
-     *h = imlib_image_get_height();
-}
-
-#endif /* HAVE_IMLIB2 */
-
 /*
  * For client use
  */
@@ -89,14 +48,18 @@ draw_line(Drawable d, int x1, int y1, int x2, int y2)
      XDrawLine(W->dpy, d, W->gc, x1, y1, x2, y2);
 }
 
-static inline unsigned short
-draw_textw(struct theme *t, const char *str)
-{
-     XRectangle r;
-
-     XmbTextExtents(t->font.fontset, str, strlen(str), NULL, &r);
-
-     return r.width;
-}
+void draw_text_len(Drawable d, struct theme *t, int x, int y, Color fg, const char *str, int len);
+void draw_text(Drawable d, struct theme *t, int x, int y, Color fg, const char *str);
+void draw_text_box(struct theme *t, const char *str, int len, struct geo *g);
+void draw_set_clip(XRectangle *r);
+void draw_set_clip_region(Region r);
+unsigned short draw_textw_len(struct theme *t, const char *str, int len);
+unsigned short draw_textw(struct theme *t, const char *str);
+char *draw_text_fit(struct theme *t, char *str, int maxw, char *buf, size_t size, int *w);
+void draw_text_flush(void);
+struct font *font_new(const char *name, bool xft);
+struct font *font_load(struct font *f);
+void font_release(struct font *f);
+void draw_free(void);
 
 #endif /* DRAW_H */
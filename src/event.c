@@ -13,6 +13,7 @@
 #include "screen.h"
 #include "systray.h"
 #include "infobar.h"
+#include "winmap.h"
 
 #define EVDPY(e) (e)->xany.display
 
@@ -31,19 +32,16 @@ event_buttonpress(XEvent *e)
      screen_update_sel();
      status_flush_surface();
 
-     SLIST_FOREACH(b, &W->h.barwin, next)
-          if(b->win == ev->window)
-          {
-               W->last_clicked_barwin = b;
-
-               SLIST_FOREACH(m, &b->mousebinds, next)
-                    MOUSE_DO_BIND(m);
+     if((b = winmap_get(ev->window, WinBarwin)))
+     {
+          W->last_clicked_barwin = b;
 
-               SLIST_FOREACH(m, &b->statusmousebinds, next)
-                    MOUSE_DO_BIND(m);
+          SLIST_FOREACH(m, &b->mousebinds, next)
+               MOUSE_DO_BIND(m);
 
-               break;
-          }
+          SLIST_FOREACH(m, &b->statusmousebinds, next)
+               MOUSE_DO_BIND(m);
+     }
 }
 
 static void
@@ -97,7 +95,7 @@ event_clientmessageevent(XEvent *e)
           else if(ev->data.l[1] == XEMBED_REQUEST_FOCUS)
           {
                if((sy = systray_find(ev->data.l[2])))
-                    ewmh_send_message(sy->win, sy->win, "_XEMBED", XEMBED_FOCUS_IN,
+                    ewmh_send_message(sy->win, sy->win, W->net_atom[xembed], XEMBED_FOCUS_IN,
                                       XEMBED_FOCUS_CURRENT, 0, 0, 0);
           }
      }
@@ -114,14 +112,14 @@ event_clientmessageevent(XEvent *e)
                     unsigned char *ret = NULL, *ret_cmd = NULL;
                     void (*func)(Uicb);
 
-                    if(XGetWindowProperty(EVDPY(e), W->root, W->net_atom[wmfs_function], 0, 65536,
-                                          False, W->net_atom[utf8_string], (Atom*)&d, &d,
-                                          (long unsigned int*)&d, (long unsigned int*)&d, &ret) == Success
+                    if(stats_xgetwindowproperty(EVDPY(e), W->root, W->net_atom[wmfs_function], 0, 65536,
+                                                False, W->net_atom[utf8_string], (Atom*)&d, &d,
+                                                (long unsigned int*)&d, (long unsigned int*)&d, &ret) == Success
                        && ret && ((func = uicb_name_func((char*)ret))))
                     {
-                         if(XGetWindowProperty(EVDPY(e), W->root, W->net_atom[wmfs_cmd], 0, 65536,
-                                               False, W->net_atom[utf8_string], (Atom*)&d, &d,
-                                               &len, (long unsigned int*)&d, &ret_cmd) == Success
+                         if(stats_xgetwindowproperty(EVDPY(e), W->root, W->net_atom[wmfs_cmd], 0, 65536,
+                                                     False, W->net_atom[utf8_string], (Atom*)&d, &d,
+                                                     &len, (long unsigned int*)&d, &ret_cmd) == Success
                             && len && ret_cmd)
                          {
                               func((Uicb)ret_cmd);
@@ -189,6 +187,9 @@ event_configureevent(XEvent *e)
 
                client_apply_tgeo(c->tag);
           }
+
+          /* Request can be refused or unchanged, notify anyway (ICCCM 4.1.5) */
+          client_configure(c);
      }
      else
      {
@@ -238,7 +239,7 @@ event_maprequest(XEvent *e)
      struct _systray *s;
 
      /* Which windows to manage */
-     if(!XGetWindowAttributes(EVDPY(e), ev->window, &at)
+     if(!stats_xgetwindowattributes(EVDPY(e), ev->window, &at)
         || at.override_redirect)
           return;
 
@@ -246,7 +247,7 @@ event_maprequest(XEvent *e)
           client_new(ev->window, &at, false);
      else if((s = systray_find(ev->window)))
      {
-          ewmh_send_message(s->win, s->win, "_XEMBED", CurrentTime,
+          ewmh_send_message(s->win, s->win, W->net_atom[xembed], CurrentTime,
                             XEMBED_WINDOW_ACTIVATE, 0, 0, 0);
           systray_update();
      }
@@ -290,7 +291,7 @@ event_propertynotify(XEvent *e)
                        && c->tag != W->screen->seltag)
                     {
                          c->tag->flags |= TAG_URGENT;
-                         infobar_elem_screen_update(c->screen, ElemTag);
+                         infobar_tag_dirty(c->tag);
                          XFree(h);
                     }
 
@@ -323,9 +324,9 @@ event_unmapnotify(XEvent *e)
           int d;
           unsigned char *ret = NULL;
 
-          if(XGetWindowProperty(EVDPY(e), c->win, W->net_atom[wm_state], 0, 2,
-                                False, W->net_atom[wm_state], (Atom*)&d, &d,
-                                (long unsigned int*)&d, (long unsigned int*)&d, &ret) == Success)
+          if(stats_xgetwindowproperty(EVDPY(e), c->win, W->net_atom[wm_state], 0, 2,
+                                      False, W->net_atom[wm_state], (Atom*)&d, &d,
+                                      (long unsigned int*)&d, (long unsigned int*)&d, &ret) == Success)
                if(*ret == NormalState)
                     client_remove(c);
      }
@@ -357,13 +358,26 @@ event_expose(XEvent *e)
 {
      XExposeEvent *ev = &e->xexpose;
      struct barwin *b;
+     struct client *c;
 
-     SLIST_FOREACH(b, &W->h.barwin, next)
-          if(b->win == ev->window)
-          {
-               barwin_refresh(b);
-               return;
-          }
+     if(!(b = winmap_get(ev->window, WinBarwin)) || !b->pix)
+          return;
+
+     /* Accumulate the serie, one clipped copy at its end */
+     if(!(b->flags & BARWIN_SCRATCH))
+          barwin_damage(b, ev->x, ev->y, ev->width, ev->height);
+
+     if(ev->count)
+          return;
+
+     /* Shared scratch pixmap content is gone, draw again */
+     if(b->flags & BARWIN_SCRATCH)
+     {
+          if((c = client_gb_titlebar(ev->window)))
+               client_frame_redraw(c);
+     }
+     else
+          barwin_refresh(b);
 }
 
 static void
@@ -381,7 +395,7 @@ event_mapnotify(XEvent *e)
      else if((s = systray_find(ev->window)))
      {
           ewmh_set_wm_state(s->win, NormalState);
-          ewmh_send_message(s->win, s->win, "_XEMBED", CurrentTime,
+          ewmh_send_message(s->win, s->win, W->net_atom[xembed], CurrentTime,
                             XEMBED_WINDOW_ACTIVATE, 0, 0, 0);
      }
 }
@@ -396,6 +410,272 @@ event_selectionclearevent(XEvent *ev)
      systray_update();
 }
 
+/** Subject window of an event, xany.window is the parent
+ *  or the event window for substructure events
+ * \param e XEvent pointer
+ * \return Window
+ */
+Window
+event_window(XEvent *e)
+{
+     switch(e->type)
+     {
+          case ConfigureRequest: return e->xconfigurerequest.window;
+          case ConfigureNotify:  return e->xconfigure.window;
+          case MapRequest:       return e->xmaprequest.window;
+          case MapNotify:        return e->xmap.window;
+          case UnmapNotify:      return e->xunmap.window;
+          case DestroyNotify:    return e->xdestroywindow.window;
+          case CreateNotify:     return e->xcreatewindow.window;
+          case ReparentNotify:   return e->xreparent.window;
+          case GravityNotify:    return e->xgravity.window;
+          case CirculateNotify:  return e->xcirculate.window;
+          case CirculateRequest: return e->xcirculaterequest.window;
+     }
+
+     return e->xany.window;
+}
+
+struct evfold
+{
+     XEvent *ref;
+     Window win;
+     bool barrier;
+};
+
+/*
+ * Match next event foldable in ref. Any other event
+ * of the same window is a barrier: it has to be handled
+ * between them, so stop matching at it.
+ */
+static Bool
+event_fold_predicate(Display *d, XEvent *e, XPointer arg)
+{
+     struct evfold *f = (struct evfold*)arg;
+     (void)d;
+
+     if(f->barrier || event_window(e) != f->win)
+          return False;
+
+     if(e->type == f->ref->type)
+     {
+          /* Properties of a same window are independent */
+          if(e->type == PropertyNotify)
+               return e->xproperty.atom == f->ref->xproperty.atom;
+
+          return True;
+     }
+
+     f->barrier = true;
+
+     return False;
+}
+
+static void
+event_fold_configure(XConfigureRequestEvent *ev, XConfigureRequestEvent *n)
+{
+     if(n->value_mask & CWX)
+          ev->x = n->x;
+     if(n->value_mask & CWY)
+          ev->y = n->y;
+     if(n->value_mask & CWWidth)
+          ev->width = n->width;
+     if(n->value_mask & CWHeight)
+          ev->height = n->height;
+     if(n->value_mask & CWBorderWidth)
+          ev->border_width = n->border_width;
+     if(n->value_mask & CWSibling)
+          ev->above = n->above;
+     if(n->value_mask & CWStackMode)
+          ev->detail = n->detail;
+
+     ev->value_mask |= n->value_mask;
+}
+
+static void
+event_fold_expose(XExposeEvent *ev, XExposeEvent *n)
+{
+     struct barwin *b;
+     int x2, y2;
+
+     /* Barwins keep each rectangle of the serie as damage */
+     if((b = winmap_get(ev->window, WinBarwin)))
+     {
+          if(!(b->flags & BARWIN_SCRATCH))
+               barwin_damage(b, n->x, n->y, n->width, n->height);
+     }
+     else
+     {
+          x2 = MAX(ev->x + ev->width,  n->x + n->width);
+          y2 = MAX(ev->y + ev->height, n->y + n->height);
+
+          ev->x      = MIN(ev->x, n->x);
+          ev->y      = MIN(ev->y, n->y);
+          ev->width  = x2 - ev->x;
+          ev->height = y2 - ev->y;
+     }
+
+     ev->count = n->count;
+}
+
+/** Merge redundant queued events in ev before its dispatch:
+ *  last ConfigureRequest, one PropertyNotify per atom and
+ *  union of an Expose serie.
+ * \param ev XEvent pointer, dequeued event to dispatch
+ */
+void
+event_coalesce(XEvent *ev)
+{
+     struct evfold f = { ev, event_window(ev), false };
+     XEvent e;
+
+     if(!XQLength(W->dpy))
+          return;
+
+     switch(ev->type)
+     {
+          case Expose:
+               if(!ev->xexpose.count)
+                    return;
+               /* Fallthrough */
+          case ConfigureRequest:
+          case PropertyNotify:
+               break;
+          default:
+               return;
+     }
+
+     while(XCheckIfEvent(W->dpy, &e, event_fold_predicate, (XPointer)&f))
+     {
+          switch(e.type)
+          {
+               case ConfigureRequest:
+                    event_fold_configure(&ev->xconfigurerequest, &e.xconfigurerequest);
+                    ++W->evstats.configure;
+                    break;
+
+               /* Handler reads property again, keep last state only */
+               case PropertyNotify:
+                    ev->xproperty.state = e.xproperty.state;
+                    ev->xproperty.time  = e.xproperty.time;
+                    ++W->evstats.property;
+                    break;
+
+               case Expose:
+                    event_fold_expose(&ev->xexpose, &e.xexpose);
+                    ++W->evstats.expose;
+
+                    if(!ev->xexpose.count)
+                         return;
+                    break;
+          }
+
+          f.barrier = false;
+     }
+}
+
+#define EVPRIO_MAXWIN 32
+
+struct evprio
+{
+     Window win[EVPRIO_MAXWIN];
+     int nwin;
+     int n;
+     bool barrier;
+};
+
+/*
+ * Match first input event of the queue, skipping only
+ * cosmetic events of other windows. Any other event is
+ * a barrier, to keep ordering with structural changes.
+ */
+static Bool
+event_prio_predicate(Display *d, XEvent *e, XPointer arg)
+{
+     struct evprio *p = (struct evprio*)arg;
+     Window w = event_window(e);
+     int i;
+     (void)d;
+
+     if(p->barrier)
+          return False;
+
+     for(i = 0; i < p->nwin && p->win[i] != w; ++i);
+
+     switch(e->type)
+     {
+          case KeyPress:
+          case ButtonPress:
+          case EnterNotify:
+          case FocusIn:
+               if(i == p->nwin)
+                    return True;
+               break;
+
+          case PropertyNotify:
+          case Expose:
+          case ConfigureRequest:
+          case ConfigureNotify:
+               if(i < EVPRIO_MAXWIN)
+               {
+                    if(i == p->nwin)
+                         p->win[p->nwin++] = w;
+                    ++p->n;
+                    return False;
+               }
+               break;
+     }
+
+     p->barrier = true;
+
+     return False;
+}
+
+/** Dequeue next input event (key, button, focus) in front of
+ *  pending cosmetic events (property, expose, configure)
+ * \param ev XEvent pointer to fill
+ * \return true if an event was dequeued, else caller has to
+ *         dequeue queue head itself
+ */
+bool
+event_next_input(XEvent *ev)
+{
+     /* Count of queue head events known without reachable input event */
+     static int known = 0;
+     static bool blocked = false;
+     struct evprio p = { .nwin = 0, .n = 0, .barrier = false };
+     int qlen = XQLength(W->dpy);
+
+     /*
+      * Rescan only if the barrier was dequeued, or if new
+      * events were queued after a full scan
+      */
+     if(qlen < 2 || (blocked ? known > 0 : qlen <= known))
+     {
+          if(known)
+               --known;
+
+          return false;
+     }
+
+     if(XCheckIfEvent(W->dpy, ev, event_prio_predicate, (XPointer)&p))
+     {
+          if(p.n)
+               ++W->evstats.reordered;
+
+          known = 0;
+          blocked = false;
+
+          return true;
+     }
+
+     /* Queue head will be dequeued by caller */
+     known = (p.n ? p.n - 1 : 0);
+     blocked = p.barrier;
+
+     return false;
+}
+
 static void
 event_dummy(XEvent *e)
 {
@@ -13,6 +13,9 @@
 #define KEYPRESS_MASK(m) (m & ~(W->numlockmask | LockMask))
 #define EVENT_HANDLE(e) event_handle[(e)->type](e);
 
+Window event_window(XEvent *e);
+void event_coalesce(XEvent *ev);
+bool event_next_input(XEvent *ev);
 void event_init(void);
 
 void (*event_handle[MAX_EV])(XEvent*);
@@ -13,6 +13,76 @@
 #define _NET_WM_STATE_ADD    1 /* add/set property */
 #define _NET_WM_STATE_TOGGLE 2 /* toggle property  */
 
+/* Every atom used by wmfs, interned at once in ewmh_init */
+static const char *const ewmh_atom_name[net_last] =
+{
+     /* ICCCM */
+     [wm_state]                       = "WM_STATE",
+     [wm_class]                       = "WM_CLASS",
+     [wm_name]                        = "WM_NAME",
+     [wm_window_role]                 = "WM_WINDOW_ROLE",
+     [wm_protocols]                   = "WM_PROTOCOLS",
+     [wm_delete_window]               = "WM_DELETE_WINDOW",
+     /* EWMH */
+     [net_supported]                  = "_NET_SUPPORTED",
+     [net_wm_name]                    = "_NET_WM_NAME",
+     [net_client_list]                = "_NET_CLIENT_LIST",
+     [net_frame_extents]              = "_NET_FRAME_EXTENTS",
+     [net_number_of_desktops]         = "_NET_NUMBER_OF_DESKTOPS",
+     [net_current_desktop]            = "_NET_CURRENT_DESKTOP",
+     [net_desktop_names]              = "_NET_DESKTOP_NAMES",
+     [net_desktop_geometry]           = "_NET_DESKTOP_GEOMETRY",
+     [net_active_window]              = "_NET_ACTIVE_WINDOW",
+     [net_close_window]               = "_NET_CLOSE_WINDOW",
+     [net_wm_icon_name]               = "_NET_WM_ICON_NAME",
+     [net_wm_window_type]             = "_NET_WM_WINDOW_TYPE",
+     [net_wm_pid]                     = "_NET_WM_PID",
+     [net_showing_desktop]            = "_NET_SHOWING_DESKTOP",
+     [net_supporting_wm_check]        = "_NET_SUPPORTING_WM_CHECK",
+     [net_wm_window_opacity]          = "_NET_WM_WINDOW_OPACITY",
+     [net_wm_window_type_normal]      = "_NET_WM_WINDOW_TYPE_NORMAL",
+     [net_wm_window_type_dock]        = "_NET_WM_WINDOW_TYPE_DOCK",
+     [net_wm_window_type_splash]      = "_NET_WM_WINDOW_TYPE_SPLASH",
+     [net_wm_window_type_dialog]      = "_NET_WM_WINDOW_TYPE_DIALOG",
+     [net_wm_desktop]                 = "_NET_WM_DESKTOP",
+     [net_wm_icon]                    = "_NET_WM_ICON",
+     [net_wm_state]                   = "_NET_WM_STATE",
+     [net_wm_state_fullscreen]        = "_NET_WM_STATE_FULLSCREEN",
+     [net_wm_state_sticky]            = "_NET_WM_STATE_STICKY",
+     [net_wm_state_demands_attention] = "_NET_WM_STATE_DEMANDS_ATTENTION",
+     [net_wm_state_hidden]            = "_NET_WM_STATE_HIDDEN",
+     [net_system_tray_opcode]         = "_NET_SYSTEM_TRAY_OPCODE",
+     [net_system_tray_message_data]   = "_NET_SYSTEM_TRAY_MESSAGE_DATA",
+     [net_system_tray_s]              = "_NET_SYSTEM_TRAY_S0",
+     [net_system_tray_visual]         = "_NET_SYSTEM_TRAY_VISUAL",
+     [net_system_tray_orientation]    = "_NET_SYSTEM_TRAY_ORIENTATION",
+     [xembed]                         = "_XEMBED",
+     [xembedinfo]                     = "_XEMBED_INFO",
+     [manager]                        = "MANAGER",
+     [utf8_string]                    = "UTF8_STRING",
+     /* WMFS hints */
+     [wmfs_running]                   = "_WMFS_RUNNING",
+     [wmfs_focus]                     = "_WMFS_FOCUS",
+     [wmfs_update_hints]              = "_WMFS_UPDATE_HINTS",
+     [wmfs_current_tag]               = "_WMFS_CURRENT_TAG",
+     [wmfs_current_screen]            = "_WMFS_CURRENT_SCREEN",
+     [wmfs_current_layout]            = "_WMFS_CURRENT_LAYOUT",
+     [wmfs_tag_list]                  = "_WMFS_TAG_LIST",
+     [wmfs_mwfact]                    = "_WMFS_MWFACT",
+     [wmfs_nmaster]                   = "_WMFS_NMASTER",
+     [wmfs_set_screen]                = "_WMFS_SET_SCREEN",
+     [wmfs_screen_count]              = "_WMFS_SCREEN_COUNT",
+     [wmfs_function]                  = "_WMFS_FUNCTION",
+     [wmfs_cmd]                       = "_WMFS_CMD",
+     [wmfs_font]                      = "_WMFS_FONT",
+     [wmfs_statustext]                = "_WMFS_STATUSTEXT",
+     [wmfs_tag]                       = "_WMFS_TAG",
+     [wmfs_screen]                    = "_WMFS_SCREEN",
+     [wmfs_flags]                     = "_WMFS_FLAGS",
+     [wmfs_geo]                       = "_WMFS_GEO",
+     [wmfs_tabmaster]                 = "_WMFS_TABMASTER",
+};
+
 void
 ewmh_init(void)
 {
@@ -20,59 +90,8 @@ ewmh_init(void)
 
      W->net_atom = xcalloc(net_last, sizeof(Atom));
 
-     /* EWMH hints */
-     W->net_atom[wm_state]                       = ATOM("WM_STATE");
-     W->net_atom[wm_class]                       = ATOM("WM_CLASS");
-     W->net_atom[wm_name]                        = ATOM("WM_NAME");
-     W->net_atom[net_supported]                  = ATOM("_NET_SUPPORTED");
-     W->net_atom[net_client_list]                = ATOM("_NET_CLIENT_LIST");
-     W->net_atom[net_frame_extents]              = ATOM("_NET_FRAME_EXTENTS");
-     W->net_atom[net_number_of_desktops]         = ATOM("_NET_NUMBER_OF_DESKTOPS");
-     W->net_atom[net_current_desktop]            = ATOM("_NET_CURRENT_DESKTOP");
-     W->net_atom[net_desktop_names]              = ATOM("_NET_DESKTOP_NAMES");
-     W->net_atom[net_desktop_geometry]           = ATOM("_NET_DESKTOP_GEOMETRY");
-     W->net_atom[net_active_window]              = ATOM("_NET_ACTIVE_WINDOW");
-     W->net_atom[net_close_window]               = ATOM("_NET_CLOSE_WINDOW");
-     W->net_atom[net_wm_name]                    = ATOM("_NET_WM_NAME");
-     W->net_atom[net_wm_pid]                     = ATOM("_NET_WM_PID");
-     W->net_atom[net_wm_desktop]                 = ATOM("_NET_WM_DESKTOP");
-     W->net_atom[net_showing_desktop]            = ATOM("_NET_SHOWING_DESKTOP");
-     W->net_atom[net_wm_icon_name]               = ATOM("_NET_WM_ICON_NAME");
-     W->net_atom[net_wm_window_type]             = ATOM("_NET_WM_WINDOW_TYPE");
-     W->net_atom[net_supporting_wm_check]        = ATOM("_NET_SUPPORTING_WM_CHECK");
-     W->net_atom[net_wm_window_opacity]          = ATOM("_NET_WM_WINDOW_OPACITY");
-     W->net_atom[net_wm_window_type_normal]      = ATOM("_NET_WM_WINDOW_TYPE_NORMAL");
-     W->net_atom[net_wm_window_type_dock]        = ATOM("_NET_WM_WINDOW_TYPE_DOCK");
-     W->net_atom[net_wm_window_type_splash]      = ATOM("_NET_WM_WINDOW_TYPE_SPLASH");
-     W->net_atom[net_wm_window_type_dialog]      = ATOM("_NET_WM_WINDOW_TYPE_DIALOG");
-     W->net_atom[net_wm_icon]                    = ATOM("_NET_WM_ICON");
-     W->net_atom[net_wm_state]                   = ATOM("_NET_WM_STATE");
-     W->net_atom[net_wm_state_fullscreen]        = ATOM("_NET_WM_STATE_FULLSCREEN");
-     W->net_atom[net_wm_state_sticky]            = ATOM("_NET_WM_STATE_STICKY");
-     W->net_atom[net_wm_state_demands_attention] = ATOM("_NET_WM_STATE_DEMANDS_ATTENTION");
-     W->net_atom[net_wm_state_hidden]            = ATOM("_NET_WM_STATE_HIDDEN");
-     W->net_atom[net_system_tray_s]              = ATOM("_NET_SYSTEM_TRAY_S0");
-     W->net_atom[net_system_tray_opcode]         = ATOM("_NET_SYSTEM_TRAY_OPCODE");
-     W->net_atom[net_system_tray_message_data]   = ATOM("_NET_SYSTEM_TRAY_MESSAGE_DATA");
-     W->net_atom[net_system_tray_visual]         = ATOM("_NET_SYSTEM_TRAY_VISUAL");
-     W->net_atom[net_system_tray_orientation]    = ATOM("_NET_SYSTEM_TRAY_ORIENTATION");
-     W->net_atom[xembed]                         = ATOM("_XEMBED");
-     W->net_atom[xembedinfo]                     = ATOM("_XEMBED_INFO");
-     W->net_atom[manager]                        = ATOM("MANAGER");
-     W->net_atom[utf8_string]                    = ATOM("UTF8_STRING");
-
-     /* WMFS hints */
-     W->net_atom[wmfs_running]                   = ATOM("_WMFS_RUNNING");
-     W->net_atom[wmfs_focus]                     = ATOM("_WMFS_FOCUS");
-     W->net_atom[wmfs_update_hints]              = ATOM("_WMFS_UPDATE_HINTS");
-     W->net_atom[wmfs_set_screen]                = ATOM("_WMFS_SET_SCREEN");
-     W->net_atom[wmfs_screen_count]              = ATOM("_WMFS_SCREEN_COUNT");
-     W->net_atom[wmfs_current_tag]               = ATOM("_WMFS_CURRENT_TAG");
-     W->net_atom[wmfs_tag_list]                  = ATOM("_WMFS_TAG_LIST");
-     W->net_atom[wmfs_current_screen]            = ATOM("_WMFS_CURRENT_SCREEN");
-     W->net_atom[wmfs_current_layout]            = ATOM("_WMFS_CURRENT_LAYOUT");
-     W->net_atom[wmfs_function]                  = ATOM("_WMFS_FUNCTION");
-     W->net_atom[wmfs_cmd]                       = ATOM("_WMFS_CMD");
+     /* Single round trip for all atoms */
+     XInternAtoms(W->dpy, (char**)ewmh_atom_name, net_last, False, W->net_atom);
 
      XChangeProperty(W->dpy, W->root, W->net_atom[net_supported], XA_ATOM, 32,
                      PropModeReplace, (unsigned char*)W->net_atom, net_last);
@@ -84,7 +103,7 @@ ewmh_init(void)
      XChangeProperty(W->dpy, W->root, W->net_atom[net_supporting_wm_check], XA_WINDOW, 32,
                      PropModeReplace, (unsigned char*)&W->root, 1);
 
-     XChangeProperty(W->dpy, W->root, ATOM("WM_CLASS"), XA_STRING, 8,
+     XChangeProperty(W->dpy, W->root, W->net_atom[wm_class], XA_STRING, 8,
                      PropModeReplace, (unsigned char*)&"wmfs", 4);
 
      XChangeProperty(W->dpy, W->root, W->net_atom[net_wm_name], W->net_atom[utf8_string], 8,
@@ -149,8 +168,8 @@ ewmh_get_xembed_state(Window win)
      unsigned long n, il;
      unsigned char *data = NULL;
 
-     if(XGetWindowProperty(W->dpy, win, W->net_atom[xembedinfo], 0L, 2, False,
-                           W->net_atom[xembedinfo], &rf, &f, &n, &il, &data) != Success)
+     if(stats_xgetwindowproperty(W->dpy, win, W->net_atom[xembedinfo], 0L, 2, False,
+                                 W->net_atom[xembedinfo], &rf, &f, &n, &il, &data) != Success)
           return 0;
 
      if(rf == W->net_atom[xembedinfo] && n == 2)
@@ -207,6 +226,9 @@ ewmh_manage_state(long data[], struct client *c)
                XReparentWindow(W->dpy, c->win, W->root, c->screen->geo.x, c->screen->geo.y);
                XResizeWindow(W->dpy, c->win, c->screen->geo.w, c->screen->geo.h);
 
+               /* Window geo isn't known anymore */
+               c->xwgeo.w = c->xwgeo.h = -1;
+
                if(c->tag)
                     client_focus(c);
 
@@ -237,8 +259,8 @@ ewmh_manage_window_type(struct client *c)
      unsigned char *data = NULL;
      long ldata[5] = { _NET_WM_STATE_ADD };
 
-     if(XGetWindowProperty(W->dpy, c->win, W->net_atom[net_wm_window_type], 0L, 0x7FFFFFFFL,
-                           False, XA_ATOM, &rf, &f, &n, &il, &data) == Success && n)
+     if(stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[net_wm_window_type], 0L, 0x7FFFFFFFL,
+                                 False, XA_ATOM, &rf, &f, &n, &il, &data) == Success && n)
      {
           atom = (Atom*)data;
 
@@ -252,8 +274,8 @@ ewmh_manage_window_type(struct client *c)
      }
 
      /* _NET_WM_STATE at window mangement */
-     if(XGetWindowProperty(W->dpy, c->win, W->net_atom[net_wm_state], 0L, 0x7FFFFFFFL, false,
-                           XA_ATOM, &rf, &f, &n, &il, &data) == Success && n)
+     if(stats_xgetwindowproperty(W->dpy, c->win, W->net_atom[net_wm_state], 0L, 0x7FFFFFFFL, false,
+                                 XA_ATOM, &rf, &f, &n, &il, &data) == Success && n)
      {
           atom = (Atom*)data;
 
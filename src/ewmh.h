@@ -42,6 +42,9 @@ enum
      wm_state,
      wm_class,
      wm_name,
+     wm_window_role,
+     wm_protocols,
+     wm_delete_window,
      /* EWMH */
      net_supported,
      net_wm_name,
@@ -95,16 +98,22 @@ enum
      wmfs_cmd,
      wmfs_font,
      wmfs_statustext,
+     /* WMFS client properties */
+     wmfs_tag,
+     wmfs_screen,
+     wmfs_flags,
+     wmfs_geo,
+     wmfs_tabmaster,
      net_last
 };
 
 static inline void
-ewmh_send_message(Window d, Window w, char *atom, long d0, long d1, long d2, long d3, long d4)
+ewmh_send_message(Window d, Window w, Atom atom, long d0, long d1, long d2, long d3, long d4)
 {
      XClientMessageEvent e;
 
      e.type          = ClientMessage;
-     e.message_type  = ATOM(atom);
+     e.message_type  = atom;
      e.window        = w;
      e.format        = 32;
      e.data.l[0]     = d0;
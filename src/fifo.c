@@ -0,0 +1,185 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  File created by David Delassus.
+ *  For license, see COPYING.
+ */
+
+#include "fifo.h"
+#include "config.h"
+#include "layout.h"
+#include "loop.h"
+#include "util.h"
+
+/* Same as wmfs -c <func> <cmd>, without X round trip */
+static void
+fifo_exec(char *line)
+{
+     void (*func)(Uicb);
+     char *cmd;
+
+     line += strspn(line, " \t");
+
+     if(!*line)
+          return;
+
+     cmd = line + strcspn(line, " \t");
+
+     if(*cmd)
+     {
+          *cmd++ = '\0';
+          cmd += strspn(cmd, " \t");
+     }
+
+     if(!(func = uicb_name_func(line)))
+     {
+          warnxl("fifo: unknown function '%s'", line);
+          return;
+     }
+
+     ++W->fifo.ncmd;
+
+     layout_begin();
+     func(*cmd ? cmd : NULL);
+     layout_commit();
+}
+
+static void
+fifo_cb(int fd, void *arg)
+{
+     (void)fd;
+     (void)arg;
+
+     fifo_read();
+}
+
+/*
+ * Directory of the FIFO: $XDG_RUNTIME_DIR, else a private 0700
+ * directory in /tmp, never a name other users could create first.
+ */
+static char*
+fifo_dir(void)
+{
+     char *dir, *env = getenv("XDG_RUNTIME_DIR");
+     struct stat st;
+
+     if(env && *env == '/')
+          return xstrdup(env);
+
+     xasprintf(&dir, "%s/wmfs-%u", P_tmpdir, (unsigned int)getuid());
+
+     if(mkdir(dir, 0700) == -1 && errno != EEXIST)
+     {
+          warnl("mkdir %s", dir);
+          free(dir);
+          return NULL;
+     }
+
+     /* Existing one must be ours and private */
+     if(lstat(dir, &st) == -1 || !S_ISDIR(st.st_mode)
+        || st.st_uid != getuid() || (st.st_mode & 077))
+     {
+          warnxl("fifo: %s is not a private directory", dir);
+          free(dir);
+          return NULL;
+     }
+
+     return dir;
+}
+
+/** Create the command FIFO <dir>/wmfs-<display>.fifo, see fifo_dir(),
+ * path is exported in $WMFS_FIFO to spawned commands
+ */
+void
+fifo_init(void)
+{
+     char *dir, *path, *disp, *p;
+
+     W->fifo.fd = -1;
+
+     if(!(dir = fifo_dir()))
+          return;
+
+     /* Display name can be a path (launchd) */
+     disp = xstrdup(DisplayString(W->dpy));
+
+     for(p = disp; (p = strchr(p, '/')); *p = '_');
+
+     xasprintf(&path, "%s/wmfs-%s.fifo", dir, disp);
+     free(disp);
+     free(dir);
+
+     unlink(path);
+
+     if(mkfifo(path, 0600) == -1)
+     {
+          warnl("mkfifo %s", path);
+          free(path);
+          return;
+     }
+
+     /* Open read-write so the fifo never reaches EOF when writers close */
+     if((W->fifo.fd = open(path, O_RDWR | O_NONBLOCK)) == -1)
+     {
+          warnl("open %s", path);
+          unlink(path);
+          free(path);
+          return;
+     }
+
+     fcntl(W->fifo.fd, F_SETFD, FD_CLOEXEC);
+     setenv("WMFS_FIFO", path, 1);
+
+     W->fifo.path = path;
+     W->fifo.len  = 0;
+     W->fifo.src  = loop_add_fd(W->fifo.fd, fifo_cb, NULL);
+}
+
+/** Read every pending line "<func> <cmd>" and execute it
+ */
+void
+fifo_read(void)
+{
+     char *p, *nl;
+     ssize_t n;
+
+     while((n = read(W->fifo.fd, W->fifo.buf + W->fifo.len,
+                     sizeof(W->fifo.buf) - W->fifo.len - 1)) > 0)
+     {
+          W->fifo.len += n;
+          W->fifo.buf[W->fifo.len] = '\0';
+
+          for(p = W->fifo.buf; (nl = memchr(p, '\n', W->fifo.len - (p - W->fifo.buf))); p = nl + 1)
+          {
+               *nl = '\0';
+               fifo_exec(p);
+          }
+
+          W->fifo.len -= p - W->fifo.buf;
+
+          /* Line longer than buffer: drop it */
+          if(W->fifo.len == sizeof(W->fifo.buf) - 1)
+          {
+               warnxl("fifo: line too long");
+               W->fifo.len = 0;
+          }
+          else
+               memmove(W->fifo.buf, p, W->fifo.len);
+     }
+
+     if(n == -1 && errno != EAGAIN && errno != EINTR)
+          warnl("fifo read");
+}
+
+void
+fifo_free(void)
+{
+     if(W->fifo.fd == -1)
+          return;
+
+     loop_del_fd(W->fifo.src);
+     close(W->fifo.fd);
+     unlink(W->fifo.path);
+     free(W->fifo.path);
+
+     W->fifo.fd = -1;
+}
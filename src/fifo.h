@@ -13,7 +13,10 @@
 #include <sys/stat.h>
 #include <string.h>
 
+#include "wmfs.h"
+
 void fifo_init(void);
 void fifo_read(void);
+void fifo_free(void);
 
 #endif /* __FIFO_H */
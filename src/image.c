@@ -0,0 +1,505 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+/*
+ * Cache of status images: decoded and scaled once by a worker thread,
+ * kept as server side pixmaps, so a draw is a single XCopyArea.
+ * Entries are keyed by (path, w, h, mtime, background), least recently
+ * used ones are freed above the memory cap.
+ * Only the worker thread calls Imlib2 once the cache is running; it
+ * never uses the X connection, the main thread creates the pixmaps.
+ */
+
+#ifdef HAVE_IMLIB2
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <X11/Xutil.h>
+#include <Imlib2.h>
+
+#include "image.h"
+#include "infobar.h"
+#include "client.h"
+#include "loop.h"
+#include "util.h"
+
+/* FNV-1a of path, mixed with the rest of the key */
+static unsigned int
+image_hash(const char *path, int w, int h, time_t mtime, Color bg)
+{
+     unsigned int hs = 2166136261u;
+
+     for(; *path; ++path)
+          hs = (hs ^ (unsigned char)*path) * 16777619u;
+
+     hs = (hs ^ (unsigned int)w) * 16777619u;
+     hs = (hs ^ (unsigned int)h) * 16777619u;
+     hs = (hs ^ (unsigned int)mtime) * 16777619u;
+
+     return (hs ^ bg) * 16777619u;
+}
+
+/* Decode, scale and flatten on bg; natural size only if w or h is 0 */
+static void
+image_decode(struct image_job *j)
+{
+     Imlib_Image im;
+     DATA32 *src;
+     unsigned int a, c, i, n;
+     bool alpha;
+
+     if(!(im = imlib_load_image(j->path)))
+          return;
+
+     imlib_context_set_image(im);
+
+     j->rw = imlib_image_get_width();
+     j->rh = imlib_image_get_height();
+
+     if(j->w <= 0 || j->h <= 0)
+     {
+          imlib_free_image();
+          return;
+     }
+
+     im = imlib_create_cropped_scaled_image(0, 0, j->rw, j->rh, j->w, j->h);
+     imlib_free_image();
+
+     if(!im)
+     {
+          j->rw = j->rh = 0;
+          return;
+     }
+
+     imlib_context_set_image(im);
+
+     alpha = imlib_image_has_alpha();
+     src   = imlib_image_get_data_for_reading_only();
+     n     = j->w * j->h;
+
+     j->data = xmalloc(n, sizeof(uint32_t));
+
+     /* Same result as blended rendering on the bar background */
+     for(i = 0; i < n; ++i)
+     {
+          if(!alpha || (a = src[i] >> 24) == 0xff)
+          {
+               j->data[i] = src[i] & 0xffffff;
+               continue;
+          }
+
+          for(j->data[i] = 0, c = 0; c < 24; c += 8)
+               j->data[i] |= ((((src[i] >> c) & 0xff) * a
+                              + ((j->bg >> c) & 0xff) * (0xff - a)) / 0xff) << c;
+     }
+
+     imlib_free_image();
+}
+
+static void*
+image_worker(void *arg)
+{
+     struct image_cache *ic = (struct image_cache*)arg;
+     struct image_job *j;
+
+     for(;;)
+     {
+          pthread_mutex_lock(&ic->lock);
+
+          while(!ic->stop && TAILQ_EMPTY(&ic->jobs))
+               pthread_cond_wait(&ic->cond, &ic->lock);
+
+          if(ic->stop)
+          {
+               pthread_mutex_unlock(&ic->lock);
+               break;
+          }
+
+          j = TAILQ_FIRST(&ic->jobs);
+          TAILQ_REMOVE(&ic->jobs, j, next);
+
+          pthread_mutex_unlock(&ic->lock);
+
+          image_decode(j);
+
+          pthread_mutex_lock(&ic->lock);
+          TAILQ_INSERT_TAIL(&ic->done, j, next);
+          pthread_mutex_unlock(&ic->lock);
+
+          /* Pipe full means main thread is already notified */
+          if(write(ic->pipe[1], "", 1) == -1)
+               continue;
+     }
+
+     return NULL;
+}
+
+static void
+image_entry_free(struct image_entry *e)
+{
+     struct image_cache *ic = W->image;
+
+     SLIST_REMOVE(&ic->bucket[e->hash % IMAGE_CACHE_BUCKETS], e, image_entry, next);
+     TAILQ_REMOVE(&ic->lru, e, lru);
+
+     if(e->pixmap)
+          XFreePixmap(W->dpy, e->pixmap);
+
+     ic->used -= e->size;
+
+     free(e->path);
+     free(e);
+}
+
+/*
+ * Free least recently used entries above the cap. Entries used since
+ * the previous decoding are kept: they are the ones drawn by the
+ * redraw it caused, or a working set bigger than the cap would be
+ * decoded again and again.
+ */
+static void
+image_evict(void)
+{
+     struct image_cache *ic = W->image;
+     struct image_entry *e, *prev;
+
+     for(e = TAILQ_LAST(&ic->lru, image_lru); e && ic->used > ic->cap; e = prev)
+     {
+          prev = TAILQ_PREV(e, image_lru, lru);
+
+          if(e->gen + 1 < ic->gen && !(e->flags & IMAGE_PENDING))
+               image_entry_free(e);
+     }
+}
+
+static Pixmap
+image_pixmap(struct image_job *j, size_t *size)
+{
+     XImage *img;
+     Pixmap p;
+     int x, y;
+
+     img = XCreateImage(W->dpy, DefaultVisual(W->dpy, W->xscreen), W->xdepth,
+                        ZPixmap, 0, NULL, j->w, j->h, 32, 0);
+
+     if(!img)
+          return None;
+
+     img->data = xmalloc(img->bytes_per_line, j->h);
+
+     for(y = 0; y < j->h; ++y)
+          for(x = 0; x < j->w; ++x)
+               XPutPixel(img, x, y, j->data[y * j->w + x]);
+
+     p = XCreatePixmap(W->dpy, W->root, j->w, j->h, W->xdepth);
+     XPutImage(W->dpy, p, W->gc, img, 0, 0, 0, 0, j->w, j->h);
+
+     *size = (size_t)img->bytes_per_line * j->h;
+
+     XDestroyImage(img);
+
+     return p;
+}
+
+/* Status context drawn without an image, flag is cleared */
+static bool
+image_ctx_wait(struct status_ctx *ctx)
+{
+     bool wait = (ctx->flags & STATUS_IMAGE_WAIT);
+
+     ctx->flags &= ~STATUS_IMAGE_WAIT;
+
+     return wait;
+}
+
+/* Redraw what was drawn before its images were decoded */
+static void
+image_redraw(void)
+{
+     struct screen *s;
+     struct theme *t;
+     struct client *c;
+     bool tags = false;
+
+     SLIST_FOREACH(t, &W->h.theme, next)
+     {
+          tags |= image_ctx_wait(&t->tags_n_sl) | image_ctx_wait(&t->tags_s_sl)
+               | image_ctx_wait(&t->tags_o_sl) | image_ctx_wait(&t->tags_u_sl);
+
+          /* Titlebars are drawn at once, not by infobar_render_dirty() */
+          if(image_ctx_wait(&t->client_n_sl) | image_ctx_wait(&t->client_s_sl))
+               SLIST_FOREACH(c, &W->h.client, next)
+                    if(c->theme == t)
+                         client_frame_update(c, CCOL(c));
+     }
+
+     SLIST_FOREACH(s, &W->h.screen, next)
+     {
+          infobar_elem_screen_update(s, ElemStatus);
+
+          if(tags)
+               infobar_elem_screen_update(s, ElemTag);
+     }
+}
+
+/* Results of worker: make pixmaps and redraw bars */
+static void
+image_done(int fd, void *arg)
+{
+     struct image_cache *ic = W->image;
+     struct image_job *j;
+     struct image_entry *e;
+     char buf[64];
+     size_t size;
+     TAILQ_HEAD(, image_job) done;
+     (void)arg;
+
+     while(read(fd, buf, sizeof(buf)) > 0);
+
+     TAILQ_INIT(&done);
+
+     ++ic->gen;
+
+     pthread_mutex_lock(&ic->lock);
+     TAILQ_CONCAT(&done, &ic->done, next);
+     pthread_mutex_unlock(&ic->lock);
+
+     while((j = TAILQ_FIRST(&done)))
+     {
+          TAILQ_REMOVE(&done, j, next);
+
+          e = j->entry;
+          e->gen = ic->gen;
+          e->flags &= ~IMAGE_PENDING;
+          e->rw = j->rw;
+          e->rh = j->rh;
+
+          if(!j->rw || (e->w > 0 && e->h > 0 && !j->data))
+               e->flags |= IMAGE_FAILED;
+          else if(j->data)
+          {
+               e->pixmap = image_pixmap(j, &size);
+               e->size  += size;
+               ic->used += size;
+          }
+
+          free(j->data);
+          free(j->path);
+          free(j);
+     }
+
+     image_evict();
+     image_redraw();
+}
+
+/* Cached entry, or new one queued to the worker */
+static struct image_entry*
+image_get(const char *path, int w, int h, time_t mtime, Color bg)
+{
+     struct image_cache *ic = W->image;
+     struct image_entry *e;
+     struct image_job *j;
+     unsigned int hs = image_hash(path, w, h, mtime, bg);
+
+     SLIST_FOREACH(e, &ic->bucket[hs % IMAGE_CACHE_BUCKETS], next)
+          if(e->hash == hs && e->w == w && e->h == h && e->mtime == mtime
+             && e->bg == bg && !strcmp(e->path, path))
+          {
+               TAILQ_REMOVE(&ic->lru, e, lru);
+               TAILQ_INSERT_HEAD(&ic->lru, e, lru);
+               e->gen = ic->gen;
+
+               return e;
+          }
+
+     e = xcalloc(1, sizeof(struct image_entry));
+     e->path  = xstrdup(path);
+     e->w     = w;
+     e->h     = h;
+     e->mtime = mtime;
+     e->bg    = bg;
+     e->hash  = hs;
+     e->flags = IMAGE_PENDING;
+     e->gen   = ic->gen;
+     e->size  = sizeof(struct image_entry) + strlen(path) + 1;
+
+     ic->used += e->size;
+
+     SLIST_INSERT_HEAD(&ic->bucket[hs % IMAGE_CACHE_BUCKETS], e, next);
+     TAILQ_INSERT_HEAD(&ic->lru, e, lru);
+
+     image_evict();
+
+     j = xcalloc(1, sizeof(struct image_job));
+     j->entry = e;
+     j->path  = xstrdup(path);
+     j->w     = w;
+     j->h     = h;
+     j->bg    = bg;
+
+     pthread_mutex_lock(&ic->lock);
+     TAILQ_INSERT_TAIL(&ic->jobs, j, next);
+     pthread_cond_signal(&ic->cond);
+     pthread_mutex_unlock(&ic->lock);
+
+     return e;
+}
+
+/** Natural size of an image
+ * \param path Image file path
+ * \param mtime Modification time of the file
+ * \param w Width return
+ * \param h Height return
+ * \return false if unknown yet or not an image
+ */
+bool
+image_size(const char *path, time_t mtime, int *w, int *h)
+{
+     struct image_entry *e;
+
+     if(!W->image)
+          return false;
+
+     e = image_get(path, 0, 0, mtime, 0);
+
+     if(e->flags & (IMAGE_PENDING | IMAGE_FAILED))
+          return false;
+
+     *w = e->rw;
+     *h = e->rh;
+
+     return true;
+}
+
+/** Draw an image scaled to g, flattened on bg
+ * \param d Drawable
+ * \param path Image file path
+ * \param mtime Modification time of the file
+ * \param g Geometry on drawable
+ * \param bg Color under transparent pixels
+ * \return false if image isn't decoded yet, bars are redrawn when it is
+ */
+bool
+image_draw(Drawable d, const char *path, time_t mtime, struct geo *g, Color bg)
+{
+     struct image_entry *e;
+
+     if(!W->image || g->w <= 0 || g->h <= 0)
+          return false;
+
+     e = image_get(path, g->w, g->h, mtime, bg);
+
+     if(!e->pixmap)
+          return false;
+
+     XCopyArea(W->dpy, e->pixmap, d, W->gc, 0, 0, g->w, g->h, g->x, g->y);
+
+     return true;
+}
+
+/** Start image cache and its decoder thread
+ * \param cap Memory cap of pixmaps, in KiB
+ */
+void
+image_init(int cap)
+{
+     struct image_cache *ic;
+     sigset_t set, old;
+     int i;
+
+     if(W->image)
+          return;
+
+     ic = W->image = xcalloc(1, sizeof(struct image_cache));
+     ic->cap = (size_t)MAX(cap, 0) << 10;
+
+     for(i = 0; i < IMAGE_CACHE_BUCKETS; ++i)
+          SLIST_INIT(&ic->bucket[i]);
+
+     TAILQ_INIT(&ic->lru);
+     TAILQ_INIT(&ic->jobs);
+     TAILQ_INIT(&ic->done);
+
+     if(pipe(ic->pipe) == -1)
+     {
+          warnl("image: pipe");
+          free(ic);
+          W->image = NULL;
+          return;
+     }
+
+     for(i = 0; i < 2; ++i)
+     {
+          fcntl(ic->pipe[i], F_SETFD, FD_CLOEXEC);
+          fcntl(ic->pipe[i], F_SETFL, fcntl(ic->pipe[i], F_GETFL) | O_NONBLOCK);
+     }
+
+     pthread_mutex_init(&ic->lock, NULL);
+     pthread_cond_init(&ic->cond, NULL);
+
+     /* Imlib2 keeps its own cache of decoded images, not needed here */
+     imlib_set_cache_size(0);
+
+     /* Signals are for the main thread */
+     sigfillset(&set);
+     pthread_sigmask(SIG_SETMASK, &set, &old);
+     i = pthread_create(&ic->thread, NULL, image_worker, ic);
+     pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+     if(i)
+     {
+          warnxl("image: can't create decoder thread");
+          close(ic->pipe[0]);
+          close(ic->pipe[1]);
+          free(ic);
+          W->image = NULL;
+          return;
+     }
+
+     ic->src = loop_add_fd(ic->pipe[0], image_done, NULL);
+}
+
+void
+image_free(void)
+{
+     struct image_cache *ic = W->image;
+     struct image_job *j;
+
+     if(!ic)
+          return;
+
+     pthread_mutex_lock(&ic->lock);
+     ic->stop = true;
+     pthread_cond_signal(&ic->cond);
+     pthread_mutex_unlock(&ic->lock);
+
+     pthread_join(ic->thread, NULL);
+
+     TAILQ_CONCAT(&ic->jobs, &ic->done, next);
+
+     while((j = TAILQ_FIRST(&ic->jobs)))
+     {
+          TAILQ_REMOVE(&ic->jobs, j, next);
+          free(j->data);
+          free(j->path);
+          free(j);
+     }
+
+     while(!TAILQ_EMPTY(&ic->lru))
+          image_entry_free(TAILQ_FIRST(&ic->lru));
+
+     loop_del_fd(ic->src);
+     close(ic->pipe[0]);
+     close(ic->pipe[1]);
+
+     pthread_mutex_destroy(&ic->lock);
+     pthread_cond_destroy(&ic->cond);
+
+     free(ic);
+     W->image = NULL;
+}
+
+#endif /* HAVE_IMLIB2 */
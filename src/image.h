@@ -0,0 +1,18 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "wmfs.h"
+
+#ifdef HAVE_IMLIB2
+void image_init(int cap);
+void image_free(void);
+bool image_size(const char *path, time_t mtime, int *w, int *h);
+bool image_draw(Drawable d, const char *path, time_t mtime, struct geo *g, Color bg);
+#endif /* HAVE_IMLIB2 */
+
+#endif /* IMAGE_H */
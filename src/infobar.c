@@ -11,6 +11,7 @@
 #include "tag.h"
 #include "status.h"
 #include "systray.h"
+#include "loop.h"
 
 #define ELEM_FREE_BARWIN(e)                     \
      while(!SLIST_EMPTY(&e->bars))              \
@@ -110,14 +111,22 @@ infobar_elem_tag_init(struct element *e)
      }
 }
 
+/* Render tag buttons, only the dirty ones if !all */
 static void
-infobar_elem_tag_update(struct element *e)
+infobar_elem_tag_render(struct element *e, bool all)
 {
      struct tag *t, *sel = e->infobar->screen->seltag;
      struct barwin *b;
 
      SLIST_FOREACH(b, &e->bars, enext)
      {
+          if(!all && !(b->flags & BARWIN_DIRTY))
+          {
+               ++W->render_saved;
+               continue;
+          }
+
+          b->flags &= ~BARWIN_DIRTY;
           t = (struct tag*)b->ptr;
 
           /* Selected */
@@ -168,21 +177,74 @@ infobar_elem_tag_update(struct element *e)
 
           barwin_refresh(b);
      }
+
+     e->flags &= ~ELEM_DIRTY_BUTTON;
+}
+
+static void
+infobar_elem_tag_update(struct element *e)
+{
+     infobar_elem_tag_render(e, true);
+}
+
+/* Place segment barwin at x, create it if needed */
+static void
+infobar_segment_place(struct element *e, struct status_segment *sg, int x)
+{
+     struct barwin *b;
+
+     if(!(b = sg->ctx.barwin))
+     {
+          b = barwin_new(e->infobar->bar->win, x, 0, sg->width, e->geo.h, 0, 0, false);
+          sg->ctx.barwin = b;
+          sg->ctx.theme  = e->infobar->theme;
+          sg->ctx.update = true;
+     }
+     else
+     {
+          barwin_move(b, x, e->geo.y);
+          barwin_resize(b, sg->width, e->geo.h);
+     }
+
+     b->fg = e->infobar->theme->bars.fg;
+     b->bg = e->infobar->theme->bars.bg;
+
+     barwin_map(b);
 }
 
 static void
 infobar_elem_status_init(struct element *e)
 {
      struct element *en = TAILQ_NEXT(e, next);
+     struct status_segment *sg;
      struct barwin *b;
+     int x, w, left = 0, right = 0;
 
      infobar_elem_placement(e);
 
      e->geo.w = e->infobar->geo.w - e->geo.x - (en ? e->infobar->geo.w - en->geo.x : 0);
 
+     /* Segments reserve their width at status element sides */
+     SLIST_FOREACH(sg, &e->infobar->segments, next)
+     {
+          if(sg->align == Left)
+          {
+               infobar_segment_place(e, sg, e->geo.x + left);
+               left += sg->width;
+          }
+          else
+          {
+               right += sg->width;
+               infobar_segment_place(e, sg, e->geo.x + e->geo.w - right);
+          }
+     }
+
+     x = e->geo.x + left;
+     w = MAX(e->geo.w - left - right, 1);
+
      if(!(b = SLIST_FIRST(&e->bars)))
      {
-          b = barwin_new(e->infobar->bar->win, e->geo.x, 0, e->geo.w, e->geo.h, 0, 0, false);
+          b = barwin_new(e->infobar->bar->win, x, 0, w, e->geo.h, 0, 0, false);
           barwin_refresh_color(b);
           SLIST_INSERT_HEAD(&e->bars, b, enext);
 
@@ -192,8 +254,8 @@ infobar_elem_status_init(struct element *e)
      }
      else
      {
-          barwin_move(b, e->geo.x, e->geo.y);
-          barwin_resize(b, e->geo.w, e->geo.h);
+          barwin_move(b, x, e->geo.y);
+          barwin_resize(b, w, e->geo.h);
      }
 
      b->fg = e->infobar->theme->bars.fg;
@@ -203,17 +265,57 @@ infobar_elem_status_init(struct element *e)
 }
 
 static void
-infobar_elem_status_update(struct element *e)
+infobar_status_ctx_update(struct status_ctx *ctx)
 {
-     if(e->infobar->statusctx.update)
-          status_manage(&e->infobar->statusctx);
+     if(!ctx->barwin)
+          return;
+
+     if(ctx->update)
+          status_manage(ctx);
      else
      {
-          status_render(&e->infobar->statusctx);
-          status_copy_mousebind(&e->infobar->statusctx);
+          status_render(ctx);
+          status_copy_mousebind(ctx);
      }
 }
 
+static void
+infobar_status_ctx_partial(struct status_ctx *ctx)
+{
+     if(!ctx->barwin)
+          return;
+
+     if(ctx->update)
+          status_manage(ctx);
+     else
+          status_flush_damage(ctx);
+}
+
+/* Render only segments with a new status and areas set by status_push */
+static void
+infobar_elem_segment_render(struct element *e)
+{
+     struct status_segment *sg;
+
+     infobar_status_ctx_partial(&e->infobar->statusctx);
+
+     SLIST_FOREACH(sg, &e->infobar->segments, next)
+          infobar_status_ctx_partial(&sg->ctx);
+
+     e->flags &= ~ELEM_DIRTY_BUTTON;
+}
+
+static void
+infobar_elem_status_update(struct element *e)
+{
+     struct status_segment *sg;
+
+     infobar_status_ctx_update(&e->infobar->statusctx);
+
+     SLIST_FOREACH(sg, &e->infobar->segments, next)
+          infobar_status_ctx_update(&sg->ctx);
+}
+
 static void
 infobar_elem_systray_init(struct element *e)
 {
@@ -230,7 +332,7 @@ infobar_elem_systray_init(struct element *e)
      if(!(b = SLIST_FIRST(&e->bars)))
      {
           b = barwin_new(e->infobar->bar->win, e->geo.x, 0, e->geo.w, e->geo.h, 0, 0, false);
-          XFreePixmap(W->dpy, b->dr);
+          barwin_drop_pixmap(b);
           SLIST_INSERT_HEAD(&e->bars, b, enext);
           W->systray.barwin = b;
           systray_acquire();
@@ -396,6 +498,211 @@ infobar_elem_update(struct infobar *i, int type)
                e->func_update(e);
 }
 
+/** Mark elements to redraw at next infobar_render_dirty()
+ * \param i Infobar
+ * \param type Element type, -1 for every element
+ */
+void
+infobar_elem_dirty(struct infobar *i, int type)
+{
+     struct element *e;
+
+     TAILQ_FOREACH(e, &i->elements, next)
+          if(type == e->type || type == -1)
+          {
+               if(e->flags & ELEM_DIRTY)
+                    ++W->render_saved;
+
+               e->flags |= ELEM_DIRTY;
+          }
+
+     W->flags |= WMFS_DIRTY;
+}
+
+static void
+infobar_status_mark(struct infobar *i, Flags what)
+{
+     struct element *e;
+
+     if(what & INFOBAR_PENDING_STATUS)
+          infobar_elem_dirty(i, ElemStatus);
+     else
+     {
+          TAILQ_FOREACH(e, &i->elements, next)
+               if(e->type == ElemStatus)
+                    e->flags |= ELEM_DIRTY_BUTTON;
+
+          W->flags |= WMFS_DIRTY;
+     }
+}
+
+static void
+infobar_status_flush(void *arg)
+{
+     struct infobar *i = (struct infobar*)arg;
+     Flags what = i->pending;
+
+     i->pending = 0;
+     i->lastrender = loop_now();
+
+     infobar_status_mark(i, what);
+}
+
+/* Mark now, or no more than i->rate times per second: faster updates
+ * are coalesced, the latest one wins and is flushed by a timer */
+static void
+infobar_status_throttle(struct infobar *i, Flags what)
+{
+     long now, next;
+
+     if(i->rate <= 0)
+     {
+          infobar_status_mark(i, what);
+          return;
+     }
+
+     /* Previous status is overwritten before being displayed */
+     if(i->pending)
+     {
+          if(i->pending & what)
+          {
+               ++i->dropped;
+               ++W->status_dropped;
+          }
+
+          i->pending |= what;
+          return;
+     }
+
+     now = loop_now();
+     next = i->lastrender + 1000 / i->rate;
+
+     if(now >= next)
+     {
+          i->lastrender = now;
+          infobar_status_mark(i, what);
+          return;
+     }
+
+     i->pending = what;
+
+     if(!i->ratetimer)
+          i->ratetimer = timer_new((int)(next - now), 0, infobar_status_flush, i);
+     else
+          timer_set(i->ratetimer, (int)(next - now));
+}
+
+/** Mark status element to redraw at next infobar_render_dirty(),
+ * rate limited by the bar "rate" option
+ * \param i Infobar
+ */
+void
+infobar_status_dirty(struct infobar *i)
+{
+     infobar_status_throttle(i, INFOBAR_PENDING_STATUS);
+}
+
+/** Mark status segments with a new status to redraw at next
+ * infobar_render_dirty(), without the rest of the status element
+ * \param i Infobar
+ */
+void
+infobar_segment_dirty(struct infobar *i)
+{
+     infobar_status_throttle(i, INFOBAR_PENDING_SEGMENT);
+}
+
+/** Add a named status segment to an infobar; its space is
+ * reserved in the status element at next element init
+ * \param i Infobar
+ * \param name Segment name
+ * \param width Reserved width
+ * \param align Left or Right side of status element
+ * \param text Initial status, can be NULL
+ */
+struct status_segment*
+infobar_segment_new(struct infobar *i, const char *name, int width, enum position align, const char *text)
+{
+     struct status_segment *sg = xcalloc(1, sizeof(struct status_segment)), *last;
+
+     sg->name  = xstrdup(name);
+     sg->width = MAX(width, 1);
+     sg->align = align;
+     sg->ctx   = status_new_ctx(NULL, i->theme);
+     sg->ctx.status = xstrdup(text ? text : "");
+
+     /* Keep declaration order */
+     SLIST_FOREACH(last, &i->segments, next)
+          if(!SLIST_NEXT(last, next))
+               break;
+
+     SLIST_INSERT_TAIL(&i->segments, sg, next, last);
+
+     return sg;
+}
+
+/** Mark buttons of a tag to redraw at next infobar_render_dirty()
+ * \param t Tag
+ */
+void
+infobar_tag_dirty(struct tag *t)
+{
+     struct infobar *i;
+     struct element *e;
+     struct barwin *b;
+
+     if(!t)
+          return;
+
+     SLIST_FOREACH(i, &t->screen->infobars, next)
+          TAILQ_FOREACH(e, &i->elements, next)
+               if(e->type == ElemTag)
+                    SLIST_FOREACH(b, &e->bars, enext)
+                         if(b->ptr == t)
+                         {
+                              if(b->flags & BARWIN_DIRTY)
+                                   ++W->render_saved;
+
+                              b->flags |= BARWIN_DIRTY;
+                              e->flags |= ELEM_DIRTY_BUTTON;
+                         }
+
+     W->flags |= WMFS_DIRTY;
+}
+
+/** Redraw every dirty element, called once per main loop iteration
+ */
+void
+infobar_render_dirty(void)
+{
+     struct screen *s;
+     struct infobar *i;
+     struct element *e;
+
+     if(!(W->flags & WMFS_DIRTY))
+          return;
+
+     W->flags &= ~WMFS_DIRTY;
+
+     SLIST_FOREACH(s, &W->h.screen, next)
+          SLIST_FOREACH(i, &s->infobars, next)
+               TAILQ_FOREACH(e, &i->elements, next)
+               {
+                    if(e->flags & ELEM_DIRTY)
+                    {
+                         e->flags &= ~(ELEM_DIRTY | ELEM_DIRTY_BUTTON);
+                         e->func_update(e);
+                    }
+                    else if(e->flags & ELEM_DIRTY_BUTTON)
+                    {
+                         if(e->type == ElemTag)
+                              infobar_elem_tag_render(e, false);
+                         else if(e->type == ElemStatus)
+                              infobar_elem_segment_render(e);
+                    }
+               }
+}
+
 void
 infobar_elem_reinit(struct infobar *i)
 {
@@ -443,6 +750,8 @@ infobar_new(struct screen *s, char *name, struct theme *theme, enum barpos pos,
      i->elemorder = xstrdup(elem);
      i->name = xstrdup(name);
 
+     SLIST_INIT(&i->segments);
+
      map = infobar_placement(i, pos);
 
      /* struct barwin create */
@@ -482,6 +791,24 @@ infobar_remove(struct infobar *i)
 
      free(i->elemorder);
      free(i->name);
+     free(i->status_template);
+
+     if(i->ratetimer)
+          timer_remove(i->ratetimer);
+
+     while(!SLIST_EMPTY(&i->segments))
+     {
+          struct status_segment *sg = SLIST_FIRST(&i->segments);
+
+          SLIST_REMOVE_HEAD(&i->segments, next);
+
+          if(sg->ctx.barwin)
+               barwin_remove(sg->ctx.barwin);
+
+          status_free_ctx(&sg->ctx);
+          free(sg->name);
+          free(sg);
+     }
 
      if(i == W->systray.infobar)
           systray_freeicons();
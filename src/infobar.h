@@ -14,6 +14,13 @@ enum { ElemTag = 0, ElemStatus, ElemSystray, ElemLauncher, ElemCustom, ElemLast
 
 struct infobar *infobar_new(struct screen *s, char *name, struct theme *theme, enum barpos pos, const char *elem);
 void infobar_elem_update(struct infobar *i, int type);
+void infobar_elem_dirty(struct infobar *i, int type);
+void infobar_tag_dirty(struct tag *t);
+void infobar_status_dirty(struct infobar *i);
+void infobar_segment_dirty(struct infobar *i);
+struct status_segment *infobar_segment_new(struct infobar *i, const char *name, int width,
+                                           enum position align, const char *text);
+void infobar_render_dirty(void);
 void infobar_refresh(struct infobar *i);
 void infobar_remove(struct infobar *i);
 void infobar_free(struct screen *s);
@@ -68,7 +75,7 @@ infobar_elem_screen_update(struct screen *s, int type)
      struct infobar *i;
 
      SLIST_FOREACH(i, &s->infobars, next)
-          infobar_elem_update(i, type);
+          infobar_elem_dirty(i, type);
 
 }
 
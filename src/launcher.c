@@ -265,6 +265,7 @@ launcher_process(struct launcher *l)
           if(ev.type != KeyPress)
           {
                EVENT_HANDLE(&ev);
+               infobar_render_dirty();
                continue;
           }
 
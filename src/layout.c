@@ -12,6 +12,38 @@
 #include "event.h"
 #include "util.h"
 
+/** Begin a layout transaction: clients ConfigureNotify are
+ *  deferred to layout_commit(). Transactions can be nested.
+ */
+void
+layout_begin(void)
+{
+     ++W->trans.depth;
+}
+
+/** End a layout transaction; the outermost one sends every
+ *  pending ConfigureNotify and flushes them in a single round trip
+ */
+void
+layout_commit(void)
+{
+     struct client *c;
+
+     if(--W->trans.depth > 0 || !W->trans.pending)
+          return;
+
+     SLIST_FOREACH(c, &W->h.client, next)
+          if(c->flags & CLIENT_CONFIGURE)
+          {
+               c->flags &= ~CLIENT_CONFIGURE;
+               client_send_configure(c);
+          }
+
+     W->trans.pending = 0;
+
+     stats_xsync(W->dpy, false);
+}
+
 void
 layout_save_set(struct tag *t)
 {
@@ -56,6 +88,8 @@ layout_apply_set(struct tag *t, struct layout_set *l)
      if(l->n != nc)
           return;
 
+     layout_begin();
+
      for(g = SLIST_FIRST(&l->geos), c = SLIST_FIRST(&t->clients);
          c; c = SLIST_NEXT(c, tnext))
      {
@@ -86,6 +120,8 @@ layout_apply_set(struct tag *t, struct layout_set *l)
           }
      */
 
+     layout_commit();
+
      /* Re-insert set in historic */
      layout_save_set(t);
 }
@@ -188,7 +224,7 @@ _historic_set(struct tag *t, bool prev)
                     break;
                }
 
-               XSync(W->dpy, False);
+               stats_xsync(W->dpy, False);
           }
           XNextEvent(W->dpy, &ev);
 
@@ -499,6 +535,8 @@ layout_rotate(struct tag *t, void (*pfunc)(struct geo*, struct geo*, struct geo*
      float f1 = (float)t->screen->ugeo.w / (float)t->screen->ugeo.h;
      float f2 = 1 / f1;
 
+     layout_begin();
+
      FOREACH_NFCLIENT(c, &t->clients, tnext)
      {
           pfunc(&g, ug, &c->geo);
@@ -516,6 +554,8 @@ layout_rotate(struct tag *t, void (*pfunc)(struct geo*, struct geo*, struct geo*
      FOREACH_NFCLIENT(c, &t->clients, tnext)
           layout_fix_hole(c);
 
+     layout_commit();
+
      layout_save_set(t);
 }
 
@@ -557,12 +597,16 @@ uicb_layout_vmirror(Uicb cmd)
      (void)cmd;
      struct client *c;
 
+     layout_begin();
+
      FOREACH_NFCLIENT(c, &W->screen->seltag->clients, tnext)
      {
           c->geo.x = W->screen->ugeo.w - (c->geo.x + c->geo.w);
           client_moveresize(c, &c->geo);
      }
 
+     layout_commit();
+
      layout_save_set(W->screen->seltag);
 }
 
@@ -572,12 +616,16 @@ uicb_layout_hmirror(Uicb cmd)
      (void)cmd;
      struct client *c;
 
+     layout_begin();
+
      FOREACH_NFCLIENT(c, &W->screen->seltag->clients, tnext)
      {
           c->geo.y = W->screen->ugeo.h - (c->geo.y + c->geo.h);
           client_moveresize(c, &c->geo);
      }
 
+     layout_commit();
+
      layout_save_set(W->screen->seltag);
 }
 
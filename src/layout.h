@@ -30,6 +30,8 @@
 /* Debug */
 #define DGEO(G) printf(": %d %d %d %d\n", G.x, G.y, G.w, G.h)
 
+void layout_begin(void);
+void layout_commit(void);
 void layout_save_set(struct tag *t);
 void layout_free_set(struct tag *t);
 void layout_split_integrate(struct client *c, struct client *sc);
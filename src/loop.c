@@ -0,0 +1,299 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "loop.h"
+#include "util.h"
+
+/* pollfd array rebuilt only when sources change */
+static struct pollfd *pfd = NULL;
+static int npfd = 0;
+static bool pfd_update = true;
+
+static void
+loop_fd_setup(int fd)
+{
+     fcntl(fd, F_SETFD, FD_CLOEXEC);
+     fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* Drain signal self-pipe, flags are already set by the signal handler */
+static void
+loop_sigread(int fd, void *arg)
+{
+     char buf[64];
+     (void)arg;
+
+     while(read(fd, buf, sizeof(buf)) > 0);
+}
+
+void
+loop_init(void)
+{
+     SLIST_INIT(&W->h.fdsource);
+     SLIST_INIT(&W->h.timer);
+
+     if(pipe(W->sigfd) == -1)
+     {
+          warnl("pipe");
+          W->sigfd[0] = W->sigfd[1] = -1;
+          return;
+     }
+
+     loop_fd_setup(W->sigfd[0]);
+     loop_fd_setup(W->sigfd[1]);
+
+     loop_add_fd(W->sigfd[0], loop_sigread, NULL);
+}
+
+void
+loop_free(void)
+{
+     while(!SLIST_EMPTY(&W->h.timer))
+          timer_remove(SLIST_FIRST(&W->h.timer));
+
+     while(!SLIST_EMPTY(&W->h.fdsource))
+          loop_del_fd(SLIST_FIRST(&W->h.fdsource));
+
+     if(W->sigfd[0] != -1)
+     {
+          close(W->sigfd[0]);
+          close(W->sigfd[1]);
+     }
+
+     free(pfd);
+     pfd = NULL;
+     npfd = 0;
+}
+
+/** Monotonic clock in milliseconds
+ * \return current time
+ */
+long
+loop_now(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+
+     return (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/** Wake up the loop, async-signal-safe
+ */
+void
+loop_signal(void)
+{
+     int e = errno;
+     ssize_t r = 0;
+
+     /* Pipe full mean the loop is already awake */
+     if(W && W->sigfd[1] > 0)
+          r = write(W->sigfd[1], "", 1);
+
+     (void)r;
+     errno = e;
+}
+
+/** Register a file descriptor to watch in main loop
+ * \param fd File descriptor
+ * \param func Callback called when fd is readable, can be NULL
+ * \param arg Callback argument
+ * \return fdsource pointer
+ */
+struct fdsource*
+loop_add_fd(int fd, void (*func)(int fd, void *arg), void *arg)
+{
+     struct fdsource *s = xcalloc(1, sizeof(struct fdsource));
+
+     s->fd   = fd;
+     s->func = func;
+     s->arg  = arg;
+
+     SLIST_INSERT_HEAD(&W->h.fdsource, s, next);
+
+     pfd_update = true;
+
+     return s;
+}
+
+void
+loop_del_fd(struct fdsource *s)
+{
+     SLIST_REMOVE(&W->h.fdsource, s, fdsource, next);
+     free(s);
+
+     pfd_update = true;
+}
+
+/* Insert timer in expiration sorted list */
+static void
+timer_insert(struct timer *t)
+{
+     struct timer *tt, *prev = NULL;
+
+     SLIST_FOREACH(tt, &W->h.timer, next)
+     {
+          if(tt->expire > t->expire)
+               break;
+          prev = tt;
+     }
+
+     SLIST_INSERT_TAIL(&W->h.timer, t, next, prev);
+
+     t->armed = true;
+}
+
+/** Create a timer
+ * \param delay First expiration in ms, -1 to create it stopped
+ * \param interval Repeat interval in ms, 0 for one-shot timer
+ * \param func Callback
+ * \param arg Callback argument
+ * \return timer pointer
+ */
+struct timer*
+timer_new(int delay, int interval, void (*func)(void *arg), void *arg)
+{
+     struct timer *t = xcalloc(1, sizeof(struct timer));
+
+     t->interval = interval;
+     t->func     = func;
+     t->arg      = arg;
+
+     if(delay >= 0)
+          timer_set(t, delay);
+
+     return t;
+}
+
+/** (Re)arm a timer
+ * \param t timer pointer
+ * \param delay Expiration in ms from now
+ */
+void
+timer_set(struct timer *t, int delay)
+{
+     timer_stop(t);
+
+     t->expire = loop_now() + delay;
+
+     timer_insert(t);
+}
+
+void
+timer_stop(struct timer *t)
+{
+     if(t->armed)
+     {
+          SLIST_REMOVE(&W->h.timer, t, timer, next);
+          t->armed = false;
+     }
+}
+
+void
+timer_remove(struct timer *t)
+{
+     timer_stop(t);
+     free(t);
+}
+
+/** Call every expired timer callbacks.
+ * A periodic timer is re-armed before its callback, so the
+ * callback is free to stop or remove it.
+ */
+void
+loop_run_timers(void)
+{
+     struct timer *t;
+     long now = loop_now();
+
+     while((t = SLIST_FIRST(&W->h.timer)) && t->expire <= now)
+     {
+          SLIST_REMOVE_HEAD(&W->h.timer, next);
+          t->armed = false;
+
+          if(t->interval > 0)
+          {
+               /* Skip missed ticks instead of bursting them */
+               t->expire += t->interval;
+               if(t->expire <= now)
+                    t->expire = now + t->interval;
+
+               timer_insert(t);
+          }
+
+          t->func(t->arg);
+     }
+}
+
+static void
+loop_pfd_build(void)
+{
+     struct fdsource *s;
+     int i = 0;
+
+     SLIST_FOREACH(s, &W->h.fdsource, next)
+          ++i;
+
+     if(i != npfd)
+          pfd = xrealloc(pfd, (npfd = i) ? i : 1, sizeof(struct pollfd));
+
+     i = 0;
+     SLIST_FOREACH(s, &W->h.fdsource, next)
+     {
+          pfd[i].fd = s->fd;
+          pfd[i].events = POLLIN;
+          ++i;
+     }
+
+     pfd_update = false;
+}
+
+/** Sleep until a fd source is readable or until the next timer
+ * expiration, then call callbacks of readable sources.
+ * Caller must check there is no X event queued before.
+ */
+void
+loop_poll(void)
+{
+     struct fdsource *s, *sn;
+     struct timer *t;
+     int i, r, timeout = -1;
+
+     if(pfd_update)
+          loop_pfd_build();
+
+     if((t = SLIST_FIRST(&W->h.timer)))
+          if((timeout = (int)(t->expire - loop_now())) < 0)
+               timeout = 0;
+
+     if((r = poll(pfd, npfd, timeout)) <= 0)
+     {
+          if(r == -1 && errno != EINTR)
+               warnl("poll");
+          return;
+     }
+
+     /*
+      * Sources list and pfd array have the same order;
+      * a callback can remove its own source, so use
+      * a safe foreach and stop on any list change.
+      */
+     for(i = 0, s = SLIST_FIRST(&W->h.fdsource); s && i < npfd; s = sn, ++i)
+     {
+          sn = SLIST_NEXT(s, next);
+
+          if(pfd[i].revents & (POLLIN | POLLHUP | POLLERR) && s->func)
+          {
+               stats_fd_run(s->func, s->fd, s->arg);
+
+               if(pfd_update)
+                    break;
+          }
+     }
+}
@@ -0,0 +1,25 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "wmfs.h"
+
+void loop_init(void);
+void loop_free(void);
+long loop_now(void);
+void loop_signal(void);
+struct fdsource *loop_add_fd(int fd, void (*func)(int fd, void *arg), void *arg);
+void loop_del_fd(struct fdsource *s);
+void loop_run_timers(void);
+void loop_poll(void);
+
+struct timer *timer_new(int delay, int interval, void (*func)(void *arg), void *arg);
+void timer_set(struct timer *t, int delay);
+void timer_stop(struct timer *t);
+void timer_remove(struct timer *t);
+
+#endif /* LOOP_H */
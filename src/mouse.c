@@ -8,6 +8,7 @@
 #include "barwin.h"
 #include "client.h"
 #include "draw.h"
+#include "winmap.h"
 
 #define _REV_SBORDER(c) draw_reversed_rect(W->root, c, false);
 
@@ -26,7 +27,7 @@ mouse_resize(struct client *c)
      int d, u, ox, oy, ix, iy;
      int mx, my;
 
-     XQueryPointer(W->dpy, W->root, &w, &w, &ox, &oy, &d, &d, (unsigned int *)&u);
+     stats_xquerypointer(W->dpy, W->root, &w, &w, &ox, &oy, &d, &d, (unsigned int *)&u);
      XGrabServer(W->dpy);
 
      if(c->flags & CLIENT_FREE)
@@ -96,7 +97,7 @@ mouse_resize(struct client *c)
                _REV_BORDER();
           }
 
-          XSync(W->dpy, false);
+          stats_xsync(W->dpy, false);
 
      } while(ev.type != ButtonRelease);
 
@@ -125,13 +126,12 @@ mouse_drag_tag(struct client *c, Window w)
      Window rw;
      int d, u;
 
-     XQueryPointer(W->dpy, w, &rw, &rw, &d, &d, &d, &d, (uint *)&u);
+     stats_xquerypointer(W->dpy, w, &rw, &rw, &d, &d, &d, &d, (uint *)&u);
 
-     SLIST_FOREACH(b, &W->h.barwin, next)
-          if(b->win == rw
-             && (t = (struct tag*)b->ptr)
-             && t != c->tag)
-               return t;
+     if((b = winmap_get(rw, WinBarwin))
+        && (t = (struct tag*)b->ptr)
+        && t != c->tag)
+          return t;
 
      return NULL;
 }
@@ -152,7 +152,7 @@ mouse_move(struct client *c, void (*func)(struct client*, struct client*))
      if(c->flags & CLIENT_TABBED && !(c->flags & CLIENT_TABMASTER))
           c = c->tabmaster;
 
-     XQueryPointer(W->dpy, W->root, &w, &w, &ox, &oy, &d, &d, (uint *)&u);
+     stats_xquerypointer(W->dpy, W->root, &w, &w, &ox, &oy, &d, &d, (uint *)&u);
 
      _REV_SBORDER(c);
 
@@ -176,7 +176,7 @@ mouse_move(struct client *c, void (*func)(struct client*, struct client*))
           }
           else
           {
-               XQueryPointer(W->dpy, W->root, &w, &w, &d, &d, &d, &d, (uint *)&u);
+               stats_xquerypointer(W->dpy, W->root, &w, &w, &d, &d, &d, &d, (uint *)&u);
 
                if(!(c2 = client_gb_win(w)))
                     if(!(c2 = client_gb_frame(w)))
@@ -195,7 +195,7 @@ mouse_move(struct client *c, void (*func)(struct client*, struct client*))
                     t = mouse_drag_tag(c, w);
           }
 
-          XSync(W->dpy, false);
+          stats_xsync(W->dpy, false);
 
      } while(ev.type != ButtonRelease);
 
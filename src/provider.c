@@ -0,0 +1,404 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+/*
+ * Status data providers: read /proc, /sys, clock... on timers and
+ * substitute their value in bars status_template, "${name}".
+ */
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/statvfs.h>
+
+#include "provider.h"
+#include "infobar.h"
+#include "status.h"
+#include "loop.h"
+#include "util.h"
+
+/* Template expansion buffer */
+static char *pbuf = NULL;
+static size_t pbufsize = 0;
+
+/* Read a small file in buf, without stdio */
+static ssize_t
+provider_read(const char *path, char *buf, size_t size)
+{
+     ssize_t n;
+     int fd;
+
+     if((fd = open(path, O_RDONLY)) == -1)
+          return -1;
+
+     if((n = read(fd, buf, size - 1)) < 0)
+          n = 0;
+
+     buf[n] = '\0';
+     close(fd);
+
+     return n;
+}
+
+/* Set new value, return true if it changed */
+static bool
+provider_set(struct provider *p, const char *v)
+{
+     if(!strcmp(p->value, v))
+          return false;
+
+     snprintf(p->value, sizeof(p->value), "%s", v);
+
+     return true;
+}
+
+static void
+provider_human(char *buf, size_t size, unsigned long long v)
+{
+     const char *unit = "BKMG";
+
+     if(v < 1024)
+     {
+          snprintf(buf, size, "%lluB", v);
+          return;
+     }
+
+     for(++unit; v >= 1024 * 1024 && unit[1]; ++unit)
+          v /= 1024;
+
+     snprintf(buf, size, "%.1f%c", v / 1024.0, *unit);
+}
+
+/* arg: strftime format */
+static bool
+provider_clock(struct provider *p)
+{
+     char buf[sizeof(p->value)];
+     time_t t = time(NULL);
+     struct tm tm;
+
+     localtime_r(&t, &tm);
+
+     if(!strftime(buf, sizeof(buf), (*p->arg ? p->arg : "%Y-%m-%d %H:%M"), &tm))
+          *buf = '\0';
+
+     return provider_set(p, buf);
+}
+
+/* Busy percentage of all cpu since previous tick */
+static bool
+provider_cpu(struct provider *p)
+{
+     char buf[256], *s = buf + 3;
+     unsigned long long v, total = 0, idle = 0, dt, di;
+     int i;
+
+     if(provider_read("/proc/stat", buf, sizeof(buf)) <= 3)
+          return false;
+
+     /* cpu user nice system idle iowait irq softirq steal */
+     for(i = 0; i < 8; ++i)
+     {
+          v = strtoull(s, &s, 10);
+          total += v;
+
+          if(i == 3 || i == 4)
+               idle += v;
+     }
+
+     dt = total - p->prev[0];
+     di = idle - p->prev[1];
+
+     p->prev[0] = total;
+     p->prev[1] = idle;
+
+     if(!dt)
+          return false;
+
+     snprintf(buf, sizeof(buf), "%llu", ((dt - di) * 100) / dt);
+
+     return provider_set(p, buf);
+}
+
+static unsigned long
+provider_meminfo(const char *buf, const char *key)
+{
+     const char *s;
+
+     if(!(s = strstr(buf, key)))
+          return 0;
+
+     return strtoul(s + strlen(key), NULL, 10);
+}
+
+/* Used memory percentage */
+static bool
+provider_mem(struct provider *p)
+{
+     char buf[2048];
+     unsigned long total, avail;
+
+     if(provider_read("/proc/meminfo", buf, sizeof(buf)) <= 0
+        || !(total = provider_meminfo(buf, "MemTotal:")))
+          return false;
+
+     avail = provider_meminfo(buf, "MemAvailable:");
+
+     snprintf(buf, sizeof(buf), "%lu", ((total - avail) * 100) / total);
+
+     return provider_set(p, buf);
+}
+
+/* 1, 5 and 15 minutes load average */
+static bool
+provider_load(struct provider *p)
+{
+     char buf[128], *s = buf;
+     int i;
+
+     if(provider_read("/proc/loadavg", buf, sizeof(buf)) <= 0)
+          return false;
+
+     for(i = 0; i < 3 && (s = strchr(s + 1, ' ')); ++i);
+
+     if(s)
+          *s = '\0';
+
+     return provider_set(p, buf);
+}
+
+static unsigned long long
+provider_netstat(const char *iface, const char *stat)
+{
+     char path[128], buf[32];
+
+     snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", iface, stat);
+
+     if(provider_read(path, buf, sizeof(buf)) <= 0)
+          return 0;
+
+     return strtoull(buf, NULL, 10);
+}
+
+/* arg: interface; "<rx>/s <tx>/s" */
+static bool
+provider_net(struct provider *p)
+{
+     char buf[sizeof(p->value)], rx[16], tx[16];
+     const char *iface = (*p->arg ? p->arg : "eth0");
+     unsigned long long r = provider_netstat(iface, "rx_bytes");
+     unsigned long long t = provider_netstat(iface, "tx_bytes");
+     long now = loop_now(), dt = now - p->prevtime;
+     bool first = !p->prevtime;
+
+     p->prevtime = now;
+
+     if(first || dt <= 0)
+     {
+          p->prev[0] = r;
+          p->prev[1] = t;
+          return false;
+     }
+
+     provider_human(rx, sizeof(rx), ((r - p->prev[0]) * 1000) / dt);
+     provider_human(tx, sizeof(tx), ((t - p->prev[1]) * 1000) / dt);
+
+     p->prev[0] = r;
+     p->prev[1] = t;
+
+     snprintf(buf, sizeof(buf), "%s %s", rx, tx);
+
+     return provider_set(p, buf);
+}
+
+/* arg: power supply name; capacity percentage */
+static bool
+provider_battery(struct provider *p)
+{
+     char path[128], buf[16];
+
+     snprintf(path, sizeof(path), "/sys/class/power_supply/%s/capacity",
+              (*p->arg ? p->arg : "BAT0"));
+
+     if(provider_read(path, buf, sizeof(buf)) <= 0)
+          return false;
+
+     buf[strcspn(buf, "\n")] = '\0';
+
+     return provider_set(p, buf);
+}
+
+/* arg: mount point; used percentage */
+static bool
+provider_disk(struct provider *p)
+{
+     char buf[16];
+     struct statvfs st;
+     unsigned long long used, avail;
+
+     if(statvfs((*p->arg ? p->arg : "/"), &st) == -1)
+          return false;
+
+     used  = st.f_blocks - st.f_bfree;
+     avail = used + st.f_bavail;
+
+     snprintf(buf, sizeof(buf), "%llu", (avail ? (used * 100) / avail : 0));
+
+     return provider_set(p, buf);
+}
+
+static const struct
+{
+     const char *type;
+     bool (*update)(struct provider *p);
+     int interval; /* default, in seconds */
+} provider_types[] =
+{
+     { "clock",   provider_clock,   1 },
+     { "cpu",     provider_cpu,     2 },
+     { "mem",     provider_mem,     5 },
+     { "load",    provider_load,    5 },
+     { "net",     provider_net,     2 },
+     { "battery", provider_battery, 30 },
+     { "disk",    provider_disk,    60 },
+};
+
+/* Expand status_template of infobar and set it as status */
+void
+provider_status_update(struct infobar *i)
+{
+     struct provider *p;
+     const char *s = i->status_template, *e, *t, *next;
+     size_t len = 0, n, v;
+
+     if(!s)
+          return;
+
+     while(*s)
+     {
+          p = NULL;
+
+          /* Next ${name} */
+          if((e = strstr(s, "${")) && (t = strchr(e, '}')))
+          {
+               SLIST_FOREACH(p, &W->h.provider, next)
+                    if(strlen(p->token) == (size_t)(t - e + 1) && !strncmp(e, p->token, t - e + 1))
+                         break;
+
+               next = t + 1;
+
+               /* Unknown provider is kept as is */
+               n = (p ? e : next) - s;
+          }
+          else
+               next = s + (n = strlen(s));
+
+          v = (p ? strlen(p->value) : 0);
+
+          if(len + n + v + 1 > pbufsize)
+               pbuf = xrealloc(pbuf, (pbufsize = (len + n + v + 1) << 1), 1);
+
+          memcpy(pbuf + len, s, n);
+          memcpy(pbuf + len + n, (p ? p->value : ""), v);
+          len += n + v;
+
+          s = next;
+     }
+
+     if(!pbuf)
+          pbuf = xcalloc((pbufsize = 1), 1);
+
+     pbuf[len] = '\0';
+
+     status_set(&i->statusctx, pbuf);
+     i->statusctx.update = true;
+     infobar_status_dirty(i);
+}
+
+/* Value changed: update every bar using it */
+static void
+provider_apply(struct provider *p)
+{
+     struct screen *s;
+     struct infobar *i;
+
+     SLIST_FOREACH(s, &W->h.screen, next)
+          SLIST_FOREACH(i, &s->infobars, next)
+               if(i->status_template && strstr(i->status_template, p->token))
+                    provider_status_update(i);
+}
+
+static void
+provider_tick(void *arg)
+{
+     struct provider *p = (struct provider*)arg;
+
+     if(p->update(p))
+          provider_apply(p);
+}
+
+/** Create a provider
+ * \param name Name used in templates as ${name}
+ * \param type clock, cpu, mem, load, net, battery or disk
+ * \param arg Type specific argument, can be empty
+ * \param interval Update interval in seconds, <= 0 for type default
+ * \return provider pointer, NULL if type is unknown
+ */
+struct provider*
+provider_new(const char *name, const char *type, const char *arg, int interval)
+{
+     struct provider *p;
+     size_t i;
+
+     for(i = 0; i < LEN(provider_types); ++i)
+          if(!strcmp(type, provider_types[i].type))
+               break;
+
+     if(i == LEN(provider_types))
+     {
+          warnxl("unknown provider type '%s'", type);
+          return NULL;
+     }
+
+     p = xcalloc(1, sizeof(struct provider));
+
+     p->name   = xstrdup(name);
+     p->arg    = xstrdup(arg);
+     p->update = provider_types[i].update;
+
+     p->token = xcalloc(strlen(name) + 4, 1);
+     sprintf(p->token, "${%s}", name);
+
+     if(interval <= 0)
+          interval = provider_types[i].interval;
+
+     /* First update at next loop iteration */
+     p->timer = timer_new(0, interval * 1000, provider_tick, p);
+
+     SLIST_INSERT_HEAD(&W->h.provider, p, next);
+
+     return p;
+}
+
+void
+provider_free(void)
+{
+     struct provider *p;
+
+     while(!SLIST_EMPTY(&W->h.provider))
+     {
+          p = SLIST_FIRST(&W->h.provider);
+          SLIST_REMOVE_HEAD(&W->h.provider, next);
+          timer_remove(p->timer);
+          free(p->name);
+          free(p->token);
+          free(p->arg);
+          free(p);
+     }
+
+     free(pbuf);
+     pbuf = NULL;
+     pbufsize = 0;
+}
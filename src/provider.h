@@ -0,0 +1,15 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef PROVIDER_H
+#define PROVIDER_H
+
+#include "wmfs.h"
+
+struct provider *provider_new(const char *name, const char *type, const char *arg, int interval);
+void provider_status_update(struct infobar *i);
+void provider_free(void);
+
+#endif /* PROVIDER_H */
@@ -0,0 +1,415 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+/*
+ * Client side rasterizer for graph and progress bar sequences:
+ * pixels are computed in a 32 bits image and sent with one
+ * XShmPutImage (or XPutImage without MIT-SHM) per sequence.
+ * Kernels are plain row loops over contiguous pixels, written to be
+ * vectorized by the compiler.
+ */
+
+#include <stdint.h>
+#include <X11/Xutil.h>
+#include <string.h>
+
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif /* HAVE_XSHM */
+
+#include "raster.h"
+#include "event.h"
+#include "util.h"
+
+#define RASTER_MINH (32)
+
+/* Scale samples to the first filled row of each column */
+static void
+raster_scale(int *restrict top, const int *restrict v, int n, int h, int max)
+{
+     float f = (max ? (float)h / (float)max : 0.0f);
+     int i, t;
+
+     for(i = 0; i < n; ++i)
+     {
+          t = h - (int)((float)v[i] * f);
+          top[i] = (t < 0 ? 0 : (t > h ? h : t));
+     }
+}
+
+/* Column fill and background clear in the same pass */
+static void
+raster_columns(uint32_t *restrict p, int stride, int w, int h,
+               const int *restrict top, uint32_t bg, uint32_t fg)
+{
+     int x, y;
+
+     for(y = 0; y < h; ++y, p += stride)
+          for(x = 0; x < w; ++x)
+               p[x] = (y >= top[x] ? fg : bg);
+}
+
+static void
+raster_fill(uint32_t *restrict p, int stride, int x, int y, int w, int h, uint32_t c)
+{
+     int i;
+
+     for(p += (y * stride) + x; h-- > 0; p += stride)
+          for(i = 0; i < w; ++i)
+               p[i] = c;
+}
+
+#ifdef HAVE_XSHM
+static int
+raster_shm_error(Display *dpy, XErrorEvent *ee)
+{
+     (void)dpy;
+     (void)ee;
+
+     W->raster->useshm = false;
+
+     return 0;
+}
+
+static void
+raster_completion(XEvent *e)
+{
+     (void)e;
+
+     if(W->raster && W->raster->inflight && !--W->raster->inflight)
+          W->raster->cursor = 0;
+}
+
+static Bool
+raster_completion_pred(Display *dpy, XEvent *e, XPointer arg)
+{
+     (void)dpy;
+     (void)arg;
+
+     return (e->type == W->raster->completion);
+}
+
+/* Wait for the server to be done with the image */
+static void
+raster_wait(void)
+{
+     XEvent ev;
+
+     while(W->raster->inflight)
+     {
+          XIfEvent(W->dpy, &ev, raster_completion_pred, NULL);
+          raster_completion(&ev);
+     }
+}
+
+static void
+raster_shm_destroy(struct raster *r)
+{
+     XShmDetach(W->dpy, &r->shm);
+     XDestroyImage(r->img);
+     shmdt(r->shm.shmaddr);
+
+     r->shmimg = false;
+}
+
+/* Use XPutImage from now on */
+static XImage*
+raster_shm_fail(struct raster *r, const char *what)
+{
+     warnxl("raster: %s failed, MIT-SHM disabled", what);
+
+     if(r->img)
+     {
+          r->img->data = NULL;
+          XDestroyImage(r->img);
+     }
+
+     r->useshm = false;
+
+     return (r->img = NULL);
+}
+
+static XImage*
+raster_shm_create(struct raster *r, int w, int h)
+{
+     int (*prev)(Display*, XErrorEvent*);
+     void *addr;
+
+     if(!(r->img = XShmCreateImage(W->dpy, DefaultVisual(W->dpy, W->xscreen), W->xdepth,
+                                   ZPixmap, NULL, &r->shm, w, h)))
+          return raster_shm_fail(r, "XShmCreateImage");
+
+     if((r->shm.shmid = shmget(IPC_PRIVATE, r->img->bytes_per_line * h, IPC_CREAT | 0600)) == -1)
+          return raster_shm_fail(r, "shmget");
+
+     if((addr = shmat(r->shm.shmid, NULL, 0)) == (void*)-1)
+     {
+          shmctl(r->shm.shmid, IPC_RMID, NULL);
+          return raster_shm_fail(r, "shmat");
+     }
+
+     r->shm.shmaddr = r->img->data = addr;
+     r->shm.readOnly = False;
+
+     /* Attach fail on remote display */
+     stats_xsync(W->dpy, False);
+     prev = XSetErrorHandler(raster_shm_error);
+     XShmAttach(W->dpy, &r->shm);
+     stats_xsync(W->dpy, False);
+     XSetErrorHandler(prev);
+
+     /* Segment is freed at detach */
+     shmctl(r->shm.shmid, IPC_RMID, NULL);
+
+     if(!r->useshm)
+     {
+          XDestroyImage(r->img);
+          shmdt(r->shm.shmaddr);
+          r->img = NULL;
+     }
+     else
+          r->shmimg = true;
+
+     return r->img;
+}
+#endif /* HAVE_XSHM */
+
+static XImage*
+raster_plain_create(struct raster *r, int w, int h)
+{
+     char *data = xcalloc(w * h, sizeof(uint32_t));
+     union { int i; char c; } bo = { 1 };
+
+     if(!(r->img = XCreateImage(W->dpy, DefaultVisual(W->dpy, W->xscreen), W->xdepth,
+                                ZPixmap, 0, data, w, h, 32, 0)))
+     {
+          free(data);
+          return NULL;
+     }
+
+     /* Pixels are written as native words, Xlib swaps if needed */
+     r->img->byte_order = (bo.c ? LSBFirst : MSBFirst);
+
+     return r->img;
+}
+
+/* Image at least w x h big */
+static bool
+raster_image(int w, int h)
+{
+     struct raster *r = W->raster;
+
+     if(r->img && r->img->width >= w && r->img->height >= h)
+          return true;
+
+     if(r->img)
+     {
+          w = MAX(w, r->img->width);
+          h = MAX(h, r->img->height);
+
+#ifdef HAVE_XSHM
+          if(r->shmimg)
+          {
+               raster_wait();
+               raster_shm_destroy(r);
+          }
+          else
+#endif /* HAVE_XSHM */
+               XDestroyImage(r->img);
+
+          r->img = NULL;
+     }
+
+     w = MAX(w, W->xmaxw);
+     h = MAX(h, RASTER_MINH);
+
+#ifdef HAVE_XSHM
+     if(r->useshm && raster_shm_create(r, w, h))
+          return true;
+#endif /* HAVE_XSHM */
+
+     if(!raster_plain_create(r, w, h))
+          return false;
+
+     /* Kernels work on 32 bits pixels only */
+     if(r->img->bits_per_pixel != 32)
+     {
+          warnxl("raster: %d bits per pixel not supported", r->img->bits_per_pixel);
+          raster_free();
+          return false;
+     }
+
+     return true;
+}
+
+/* Area of w x h pixels the server is not reading, return its x in image */
+static uint32_t*
+raster_begin(int w, int h, int *x)
+{
+     *x = 0;
+
+     if(!raster_image(w, h))
+          return NULL;
+
+#ifdef HAVE_XSHM
+     if(W->raster->shmimg)
+     {
+          if(W->raster->cursor + w > W->raster->img->width)
+               raster_wait();
+
+          *x = W->raster->cursor;
+          W->raster->cursor += w;
+     }
+#endif /* HAVE_XSHM */
+
+     return (uint32_t*)W->raster->img->data + *x;
+}
+
+static void
+raster_put(Drawable d, int x, struct geo *g)
+{
+#ifdef HAVE_XSHM
+     /* Only completed puts are waited for */
+     if(W->raster->shmimg)
+     {
+          XShmPutImage(W->dpy, d, W->gc, W->raster->img, x, 0, g->x, g->y, g->w, g->h, True);
+          ++W->raster->inflight;
+          return;
+     }
+#endif /* HAVE_XSHM */
+
+     XPutImage(W->dpy, d, W->gc, W->raster->img, x, 0, g->x, g->y, g->w, g->h);
+}
+
+/** Draw a graph sequence
+ * \param d Drawable
+ * \param sq Graph sequence
+ * \param gc Samples of the graph
+ * \return false if X primitives must be used instead
+ */
+bool
+raster_graph(Drawable d, struct status_seq *sq, struct status_gcache *gc)
+{
+     struct raster *r = W->raster;
+     uint32_t *p;
+     int i, j, x, n = sq->geo.w;
+
+     if(!r || n <= 0 || sq->geo.h <= 0)
+          return false;
+
+     if(r->ntop < n * 2)
+          r->top = xrealloc(r->top, (r->ntop = n * 2), sizeof(int));
+
+     /* Unroll ring buffer: oldest sample on the left, newest on the right */
+     for(i = n - 1, j = 1; i >= 0; --i, ++j)
+          r->top[n + i] = (j <= gc->ndata ? gc->datas[(gc->head - j + gc->size) % gc->size] : 0);
+
+     raster_scale(r->top, r->top + n, n, sq->geo.h, sq->data[2]);
+
+     if(!(p = raster_begin(n, sq->geo.h, &x)))
+          return false;
+
+     raster_columns(p, r->img->bytes_per_line >> 2, n, sq->geo.h, r->top, sq->color, sq->color2);
+     raster_put(d, x, &sq->geo);
+
+     return true;
+}
+
+/** Draw a rectangle with an inner rectangle, used by progress bars
+ * \param d Drawable
+ * \param g Outer rectangle
+ * \param bg Outer color
+ * \param in Inner rectangle, in drawable coordinates
+ * \param fg Inner color
+ * \return false if X primitives must be used instead
+ */
+bool
+raster_rects(Drawable d, struct geo *g, Color bg, struct geo *in, Color fg)
+{
+     uint32_t *p;
+     int x, stride, ix, iy, iw, ih;
+
+     if(!W->raster || g->w <= 0 || g->h <= 0
+        || !(p = raster_begin(g->w, g->h, &x)))
+          return false;
+
+     stride = W->raster->img->bytes_per_line >> 2;
+
+     /* Inner rectangle clipped to outer one */
+     ix = MAX(in->x - g->x, 0);
+     iy = MAX(in->y - g->y, 0);
+     iw = MIN(in->x - g->x + in->w, g->w) - ix;
+     ih = MIN(in->y - g->y + in->h, g->h) - iy;
+
+     raster_fill(p, stride, 0, 0, g->w, g->h, bg);
+
+     if(iw > 0 && ih > 0)
+          raster_fill(p, stride, ix, iy, iw, ih, fg);
+
+     raster_put(d, x, g);
+
+     return true;
+}
+
+void
+raster_init(void)
+{
+     struct raster *r;
+     Visual *v = DefaultVisual(W->dpy, W->xscreen);
+
+     if(W->raster)
+          return;
+
+     if(v->class != TrueColor || (W->xdepth != 24 && W->xdepth != 32))
+     {
+          warnxl("raster: only 24 and 32 bits TrueColor visuals are supported");
+          return;
+     }
+
+     r = W->raster = xcalloc(1, sizeof(struct raster));
+
+#ifdef HAVE_XSHM
+     if((r->useshm = XShmQueryExtension(W->dpy)))
+     {
+          r->completion = XShmGetEventBase(W->dpy) + ShmCompletion;
+
+          /* Completions must be handled, raster_wait() would block */
+          if(r->completion < MAX_EV)
+               event_handle[r->completion] = raster_completion;
+          else
+               r->useshm = false;
+     }
+#else
+     (void)r;
+#endif /* HAVE_XSHM */
+}
+
+void
+raster_free(void)
+{
+     struct raster *r = W->raster;
+
+     if(!r)
+          return;
+
+     if(r->img)
+     {
+#ifdef HAVE_XSHM
+          if(r->shmimg)
+          {
+               raster_wait();
+               raster_shm_destroy(r);
+          }
+          else
+#endif /* HAVE_XSHM */
+               XDestroyImage(r->img);
+     }
+
+     free(r->top);
+     free(r);
+
+     W->raster = NULL;
+}
@@ -0,0 +1,16 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "wmfs.h"
+
+void raster_init(void);
+void raster_free(void);
+bool raster_graph(Drawable d, struct status_seq *sq, struct status_gcache *gc);
+bool raster_rects(Drawable d, struct geo *g, Color bg, struct geo *in, Color fg);
+
+#endif /* RASTER_H */
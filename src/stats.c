@@ -0,0 +1,291 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#include <time.h>
+
+#include "wmfs.h"
+#include "event.h"
+#include "layout.h"
+#include "util.h"
+
+static const char *const stats_sync_name[StatsSyncLast] =
+{
+     [StatsXSync]                = "XSync",
+     [StatsXGetWindowProperty]   = "XGetWindowProperty",
+     [StatsXQueryPointer]        = "XQueryPointer",
+     [StatsXGetWindowAttributes] = "XGetWindowAttributes",
+     [StatsXInternAtom]          = "XInternAtom",
+};
+
+static const char *const stats_event_name[LASTEvent] =
+{
+     [0]                = "none",
+     [KeyPress]         = "KeyPress",
+     [KeyRelease]       = "KeyRelease",
+     [ButtonPress]      = "ButtonPress",
+     [ButtonRelease]    = "ButtonRelease",
+     [MotionNotify]     = "MotionNotify",
+     [EnterNotify]      = "EnterNotify",
+     [LeaveNotify]      = "LeaveNotify",
+     [FocusIn]          = "FocusIn",
+     [FocusOut]         = "FocusOut",
+     [KeymapNotify]     = "KeymapNotify",
+     [Expose]           = "Expose",
+     [GraphicsExpose]   = "GraphicsExpose",
+     [NoExpose]         = "NoExpose",
+     [VisibilityNotify] = "VisibilityNotify",
+     [CreateNotify]     = "CreateNotify",
+     [DestroyNotify]    = "DestroyNotify",
+     [UnmapNotify]      = "UnmapNotify",
+     [MapNotify]        = "MapNotify",
+     [MapRequest]       = "MapRequest",
+     [ReparentNotify]   = "ReparentNotify",
+     [ConfigureNotify]  = "ConfigureNotify",
+     [ConfigureRequest] = "ConfigureRequest",
+     [GravityNotify]    = "GravityNotify",
+     [ResizeRequest]    = "ResizeRequest",
+     [CirculateNotify]  = "CirculateNotify",
+     [CirculateRequest] = "CirculateRequest",
+     [PropertyNotify]   = "PropertyNotify",
+     [SelectionClear]   = "SelectionClear",
+     [SelectionRequest] = "SelectionRequest",
+     [SelectionNotify]  = "SelectionNotify",
+     [ColormapNotify]   = "ColormapNotify",
+     [ClientMessage]    = "ClientMessage",
+     [MappingNotify]    = "MappingNotify",
+     [GenericEvent]     = "GenericEvent",
+};
+
+void
+stats_init(void)
+{
+     if(!W->stats)
+          W->stats = xcalloc(1, sizeof(struct stats));
+}
+
+void
+stats_free(void)
+{
+     free(W->stats);
+     W->stats = NULL;
+}
+
+static inline unsigned long
+stats_now(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+
+     return (ts.tv_sec * 1000000UL) + (ts.tv_nsec / 1000);
+}
+
+/* End a measure started at t, attributed to slot */
+static void
+stats_account(int slot, int pcur, unsigned long t)
+{
+     struct stats *s;
+     int b = 0;
+
+     /* Stats can be reset by the handler itself */
+     if(!(s = W->stats))
+          return;
+
+     s->cur = pcur;
+
+     t = stats_now() - t;
+
+     while(b < STATS_NBUCKET - 1 && (t >> b) > 1)
+          ++b;
+
+     ++s->count[slot];
+     ++s->hist[slot][b];
+     s->total[slot] += t;
+
+     if(t > s->max[slot])
+          s->max[slot] = t;
+}
+
+/** Handle an event and commit its layout changes, measuring
+ *  the whole as the event latency
+ * \param ev XEvent pointer
+ */
+void
+stats_event_handle(XEvent *ev)
+{
+     int pcur = W->stats->cur;
+     unsigned long t = stats_now();
+
+     W->stats->cur = ev->type & (STATS_NEV - 1);
+
+     EVENT_HANDLE(ev);
+     layout_commit();
+
+     stats_account(ev->type & (STATS_NEV - 1), pcur, t);
+}
+
+/** Run work of the main loop out of event handlers, accounted
+ * in its own "loop" entry
+ * \param func Work function
+ */
+void
+stats_loop_run(void (*func)(void))
+{
+     int pcur;
+     unsigned long t;
+
+     if(!W->stats)
+     {
+          func();
+          return;
+     }
+
+     pcur = W->stats->cur;
+     t = stats_now();
+
+     W->stats->cur = STATS_LOOP;
+
+     func();
+
+     stats_account(STATS_LOOP, pcur, t);
+}
+
+/** Run callback of a ready fd source, accounted in its own
+ * "fd" entry
+ * \param func Fd source callback
+ * \param fd File descriptor
+ * \param arg Callback argument
+ */
+void
+stats_fd_run(void (*func)(int, void*), int fd, void *arg)
+{
+     int pcur;
+     unsigned long t;
+
+     if(!W->stats)
+     {
+          func(fd, arg);
+          return;
+     }
+
+     pcur = W->stats->cur;
+     t = stats_now();
+
+     W->stats->cur = STATS_FD;
+
+     func(fd, arg);
+
+     stats_account(STATS_FD, pcur, t);
+}
+
+void
+stats_xerror(int request_code)
+{
+     if(W->stats)
+          ++W->stats->xerror[request_code & 0xff];
+}
+
+static void
+stats_dump_event(FILE *f, struct stats *s, int type, bool *first)
+{
+     int i;
+     bool sfirst = true;
+
+     if(!*first)
+          fprintf(f, ",\n");
+     *first = false;
+
+     if(type == STATS_LOOP)
+          fprintf(f, "    \"loop\": {");
+     else if(type == STATS_FD)
+          fprintf(f, "    \"fd\": {");
+     else if(type < LASTEvent && stats_event_name[type])
+          fprintf(f, "    \"%s\": {", stats_event_name[type]);
+     else
+          fprintf(f, "    \"%d\": {", type);
+
+     fprintf(f, " \"count\": %lu, \"avg_us\": %lu, \"max_us\": %lu,",
+             s->count[type], (s->count[type] ? s->total[type] / s->count[type] : 0),
+             s->max[type]);
+
+     /* Histogram: bucket i is [2^i, 2^(i+1)[ us */
+     fprintf(f, " \"hist\": [");
+     for(i = 0; i < STATS_NBUCKET; ++i)
+          fprintf(f, "%s%lu", (i ? ", " : ""), s->hist[type][i]);
+     fprintf(f, "],");
+
+     fprintf(f, " \"sync\": {");
+     for(i = 0; i < StatsSyncLast; ++i)
+          if(s->sync[type][i])
+          {
+               fprintf(f, "%s\"%s\": %lu", (sfirst ? " " : ", "),
+                       stats_sync_name[i], s->sync[type][i]);
+               sfirst = false;
+          }
+     fprintf(f, " } }");
+}
+
+/** Write instrumentation report to log file, JSON formatted
+ * \param cmd Unused
+ */
+void
+uicb_stats_dump(Uicb cmd)
+{
+     struct stats *s = W->stats;
+     FILE *f = W->log;
+     bool first = true;
+     int i, j;
+     (void)cmd;
+
+     if(!f)
+          return;
+
+     if(!s)
+     {
+          warnxl("stats_dump: stats are disabled, enable [misc] stats or run stats_reset");
+          return;
+     }
+
+     fprintf(f, "{\n  \"events\": {\n");
+
+     for(i = 0; i < STATS_NSLOT; ++i)
+     {
+          for(j = 0; j < StatsSyncLast && !s->sync[i][j]; ++j);
+
+          if(s->count[i] || j < StatsSyncLast)
+               stats_dump_event(f, s, i, &first);
+     }
+
+     fprintf(f, "\n  },\n  \"xerrors\": {");
+
+     for(first = true, i = 0; i < 256; ++i)
+          if(s->xerror[i])
+          {
+               fprintf(f, "%s\"%d\": %lu", (first ? " " : ", "), i, s->xerror[i]);
+               first = false;
+          }
+
+     fprintf(f, " },\n  \"status\": { \"renders\": %lu, \"requests\": %lu, \"max\": %lu",
+             s->status_render, s->status_req, s->status_reqmax);
+
+     fprintf(f, " },\n  \"folded\": { \"configure\": %lu, \"property\": %lu, \"expose\": %lu },\n"
+                "  \"reordered\": %lu,\n  \"renders_saved\": %lu,\n  \"status_dropped\": %lu\n}\n",
+             W->evstats.configure, W->evstats.property, W->evstats.expose,
+             W->evstats.reordered, W->render_saved, W->status_dropped);
+
+     fflush(f);
+}
+
+/** Reset instrumentation data, enable it if disabled
+ * \param cmd Unused
+ */
+void
+uicb_stats_reset(Uicb cmd)
+{
+     (void)cmd;
+
+     stats_free();
+     stats_init();
+}
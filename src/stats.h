@@ -0,0 +1,89 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * Included at the end of wmfs.h; synchronous Xlib calls are made
+ * through the stats_x* wrappers below to be counted.
+ */
+
+void stats_init(void);
+void stats_free(void);
+void stats_event_handle(XEvent *ev);
+void stats_loop_run(void (*func)(void));
+void stats_fd_run(void (*func)(int, void*), int fd, void *arg);
+void stats_xerror(int request_code);
+void uicb_stats_dump(Uicb cmd);
+void uicb_stats_reset(Uicb cmd);
+
+/* Count a synchronous call made by current event handler */
+static inline void
+stats_sync(enum stats_sync_call call)
+{
+     if(W && W->stats)
+          ++W->stats->sync[W->stats->cur][call];
+}
+
+/* Count X requests sent by a status render */
+static inline void
+stats_status_render(unsigned long nreq)
+{
+     if(W && W->stats)
+     {
+          ++W->stats->status_render;
+          W->stats->status_req += nreq;
+
+          if(nreq > W->stats->status_reqmax)
+               W->stats->status_reqmax = nreq;
+     }
+}
+
+static inline int
+stats_xsync(Display *dpy, Bool discard)
+{
+     stats_sync(StatsXSync);
+
+     return XSync(dpy, discard);
+}
+
+static inline int
+stats_xgetwindowproperty(Display *dpy, Window w, Atom prop, long off, long len,
+                         Bool del, Atom req, Atom *type, int *format,
+                         unsigned long *n, unsigned long *after, unsigned char **data)
+{
+     stats_sync(StatsXGetWindowProperty);
+
+     return XGetWindowProperty(dpy, w, prop, off, len, del, req,
+                               type, format, n, after, data);
+}
+
+static inline Bool
+stats_xquerypointer(Display *dpy, Window w, Window *root, Window *child,
+                    int *rx, int *ry, int *wx, int *wy, unsigned int *mask)
+{
+     stats_sync(StatsXQueryPointer);
+
+     return XQueryPointer(dpy, w, root, child, rx, ry, wx, wy, mask);
+}
+
+static inline Status
+stats_xgetwindowattributes(Display *dpy, Window w, XWindowAttributes *at)
+{
+     stats_sync(StatsXGetWindowAttributes);
+
+     return XGetWindowAttributes(dpy, w, at);
+}
+
+static inline Atom
+stats_xinternatom(Display *dpy, const char *name, Bool only)
+{
+     stats_sync(StatsXInternAtom);
+
+     return XInternAtom(dpy, name, only);
+}
+
+#endif /* STATS_H */
@@ -9,13 +9,86 @@
 #include "infobar.h"
 #include "util.h"
 #include "draw.h"
+#include "raster.h"
+#include "stats.h"
+#include "image.h"
 
 #include <string.h>
+#include <sys/stat.h>
 
-struct status_seq*
-status_new_seq(char type, int narg, int minarg, char *args[], int *shift)
+#define STATUS_ARENA_BLOCK (4096)
+#define STATUS_DL_BATCHES  (8)
+
+/* Display list of the status being drawn, a batch per color */
+static struct status_dlbatch dl[STATUS_DL_BATCHES];
+static int ndl = 0;
+static struct status_ctx *dlctx = NULL;
+
+/* Allocate zeroed memory valid until the next reset of the arena */
+static void*
+status_arena_alloc(struct status_arena *a, size_t n)
+{
+     struct status_arena_block *b, *last = NULL;
+     void *ret;
+
+     n = (n + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+     for(b = a->cur; b; last = b, b = SLIST_NEXT(b, next))
+          if(b->size - b->used >= n)
+               break;
+
+     /* Only happen until blocks are big enough for the longest status */
+     if(!b)
+     {
+          b = xmalloc(1, sizeof(struct status_arena_block) + MAX(n, STATUS_ARENA_BLOCK));
+          b->size = MAX(n, STATUS_ARENA_BLOCK);
+          b->used = 0;
+
+          if(!last)
+               SLIST_FOREACH(last, &a->blocks, next)
+                    if(!SLIST_NEXT(last, next))
+                         break;
+
+          SLIST_INSERT_TAIL(&a->blocks, b, next, last);
+     }
+
+     a->cur = b;
+     ret = b->data + b->used;
+     b->used += n;
+
+     return memset(ret, 0, n);
+}
+
+static void
+status_arena_reset(struct status_arena *a)
+{
+     struct status_arena_block *b;
+
+     SLIST_FOREACH(b, &a->blocks, next)
+          b->used = 0;
+
+     a->cur = SLIST_FIRST(&a->blocks);
+}
+
+static void
+status_arena_free(struct status_arena *a)
 {
-     struct status_seq *sq = xcalloc(1, sizeof(struct status_seq));
+     struct status_arena_block *b;
+
+     while(!SLIST_EMPTY(&a->blocks))
+     {
+          b = SLIST_FIRST(&a->blocks);
+          SLIST_REMOVE_HEAD(&a->blocks, next);
+          free(b);
+     }
+
+     a->cur = NULL;
+}
+
+static struct status_seq*
+status_new_seq(struct status_arena *a, char type, int narg, int minarg, char *args[], int *shift)
+{
+     struct status_seq *sq = status_arena_alloc(a, sizeof(struct status_seq));
 
      SLIST_INIT(&sq->mousebinds);
      sq->type = type;
@@ -39,8 +112,14 @@ status_new_ctx(struct barwin *b, struct theme *t)
 {
      struct status_ctx ctx = { .barwin = b, .theme = t };
 
+     int i;
+
      SLIST_INIT(&ctx.statushead);
-     SLIST_INIT(&ctx.gcache);
+
+     for(i = 0; i < STATUS_GCACHE_BUCKETS; ++i)
+          SLIST_INIT(&ctx.gcache[i]);
+     SLIST_INIT(&ctx.arena[0].blocks);
+     SLIST_INIT(&ctx.arena[1].blocks);
 
      return ctx;
 }
@@ -49,15 +128,17 @@ static void
 status_gcache_free(struct status_ctx *ctx)
 {
      struct status_gcache *gc;
+     int i;
 
-     while(!SLIST_EMPTY(&ctx->gcache))
-     {
-          gc = SLIST_FIRST(&ctx->gcache);
-          SLIST_REMOVE_HEAD(&ctx->gcache, next);
-          free(gc->datas);
-          free(gc->name);
-          free(gc);
-     }
+     for(i = 0; i < STATUS_GCACHE_BUCKETS; ++i)
+          while(!SLIST_EMPTY(&ctx->gcache[i]))
+          {
+               gc = SLIST_FIRST(&ctx->gcache[i]);
+               SLIST_REMOVE_HEAD(&ctx->gcache[i], next);
+               free(gc->datas);
+               free(gc->name);
+               free(gc);
+          }
 }
 
 void
@@ -66,65 +147,396 @@ status_free_ctx(struct status_ctx *ctx)
      free(ctx->status);
      status_flush_list(ctx);
      status_gcache_free(ctx);
+     status_arena_free(&ctx->arena[0]);
+     status_arena_free(&ctx->arena[1]);
+}
+
+/* FNV-1a */
+static unsigned int
+status_gcache_hash(const char *name)
+{
+     unsigned int h = 2166136261u;
+
+     for(; *name; ++name)
+          h = (h ^ (unsigned char)*name) * 16777619u;
+
+     return h;
+}
+
+static struct status_gcache*
+status_gcache_get(struct status_ctx *ctx, const char *name, unsigned int h)
+{
+     struct status_gcache *gc;
+
+     SLIST_FOREACH(gc, &ctx->gcache[h % STATUS_GCACHE_BUCKETS], next)
+          if(gc->hash == h && !strcmp(name, gc->name))
+               return gc;
+
+     return NULL;
 }
 
+/* Make room for n more elements of size sz in *p */
 static void
-status_graph_draw(struct status_ctx *ctx, struct status_seq *sq, struct status_gcache *gc)
+status_dl_grow(void **p, int *m, int n, size_t sz)
 {
-     int i, j, y;
-     int ys = sq->geo.y + sq->geo.h - 1;
+     if(n > *m)
+          *p = xrealloc(*p, (*m = MAX(n, *m << 1)), sz);
+}
+
+static bool
+geo_overlap(struct geo *a, struct geo *b)
+{
+     return (a->x < b->x + b->w && a->x + a->w > b->x
+             && a->y < b->y + b->h && a->y + a->h > b->y);
+}
+
+static bool
+status_dl_covers(struct status_dlbatch *b, struct geo *g)
+{
+     int i;
+
+     for(i = 0; i < b->nbox; ++i)
+          if(geo_overlap(&b->boxes[i], g))
+               return true;
+
+     return false;
+}
 
-     XSetForeground(W->dpy, W->gc, sq->color2);
+/*
+ * Draw pending primitives: a XSetForeground per color, then rectangles,
+ * segments and texts of a same baseline in one request each.
+ */
+static void
+status_dl_flush(void)
+{
+     static XmbTextItem *item = NULL;
+     static int nitem = 0;
+     struct status_dlbatch *b;
+     struct status_dltext *t;
+     struct theme *th;
+     Drawable d;
+     XFontSet fs;
+     int i, j, n;
+
+     if(!ndl)
+          return;
+
+     d  = dlctx->barwin->dr;
+     th = dlctx->theme;
+     fs = FONT(th)->fontset;
 
-     for(i = sq->geo.x + sq->geo.w - 1, j = gc->ndata - 1;
-         j >= 0 && i >= sq->geo.x;
-         --j, --i)
+     for(b = dl; b < dl + ndl; ++b)
      {
-          /* You divided by zero didn't you? */
-          if(gc->datas[j])
+          XSetForeground(W->dpy, W->gc, b->color);
+
+          if(b->nrect)
+               XFillRectangles(W->dpy, d, W->gc, b->rects, b->nrect);
+
+          if(b->nseg)
+               XDrawSegments(W->dpy, d, W->gc, b->segs, b->nseg);
+
+#ifdef HAVE_XFT
+          /* A XRender request per string */
+          if(FONT(th)->xft)
           {
-               y = ys - (sq->geo.h / ((float)sq->data[2] / (float)gc->datas[j])) + 1;
-               draw_line(ctx->barwin->dr, i, y, i, ys);
+               for(i = 0; i < b->ntext; ++i)
+                    draw_text_len(d, th, b->texts[i].x, b->texts[i].y,
+                                  b->color, b->texts[i].str, b->texts[i].len);
+
+               b->ntext = 0;
+          }
+#endif /* HAVE_XFT */
+
+          for(i = 0; i < b->ntext; i = j)
+          {
+               t = &b->texts[i];
+
+               for(j = i + 1; j < b->ntext && b->texts[j].y == t->y; ++j);
+
+               status_dl_grow((void**)&item, &nitem, j - i, sizeof(XmbTextItem));
+
+               /* Delta is from the end of previous item */
+               for(n = 0; n < j - i; ++n)
+               {
+                    item[n].chars    = t[n].str;
+                    item[n].nchars   = t[n].len;
+                    item[n].font_set = (n ? None : fs);
+                    item[n].delta    = (n ? t[n].x - t[n - 1].x
+                                        - XmbTextEscapement(fs, t[n - 1].str, t[n - 1].len) : 0);
+               }
+
+               XmbDrawText(W->dpy, d, W->gc, t->x, t->y, item, n);
           }
+
+          b->nrect = b->nseg = b->ntext = b->nbox = 0;
+     }
+
+     ndl = 0;
+}
+
+/*
+ * Batch of color c for a primitive painting g. Batches are drawn in
+ * creation order: a primitive can join an existing batch only if no
+ * later batch of another color has something under it.
+ */
+static struct status_dlbatch*
+status_dl_batch(Color c, struct geo *g)
+{
+     struct status_dlbatch *b;
+     int i;
+
+     for(i = 0; i < ndl && dl[i].color != c; ++i);
+
+     if(i < ndl)
+     {
+          for(b = dl + i + 1; b < dl + ndl; ++b)
+               if(status_dl_covers(b, g))
+               {
+                    status_dl_flush();
+                    break;
+               }
+     }
+
+     if(i >= ndl)
+     {
+          if(ndl == STATUS_DL_BATCHES)
+               status_dl_flush();
+
+          i = ndl++;
+          dl[i].color = c;
      }
+
+     b = &dl[i];
+
+     status_dl_grow((void**)&b->boxes, &b->mbox, b->nbox + 1, sizeof(struct geo));
+     b->boxes[b->nbox++] = *g;
+
+     return b;
+}
+
+static void
+status_dl_rect(struct geo *g, Color c)
+{
+     struct status_dlbatch *b;
+     XRectangle *r;
+
+     if(g->w <= 0 || g->h <= 0)
+          return;
+
+     b = status_dl_batch(c, g);
+
+     status_dl_grow((void**)&b->rects, &b->mrect, b->nrect + 1, sizeof(XRectangle));
+
+     r = &b->rects[b->nrect++];
+     r->x      = g->x;
+     r->y      = g->y;
+     r->width  = g->w;
+     r->height = g->h;
 }
 
 static void
-status_graph_process(struct status_ctx *ctx, struct status_seq *sq, char *name)
+status_dl_segments(XSegment *seg, int n, struct geo *g, Color c)
 {
-     int j;
+     struct status_dlbatch *b;
+
+     if(!n)
+          return;
+
+     b = status_dl_batch(c, g);
+
+     status_dl_grow((void**)&b->segs, &b->mseg, b->nseg + n, sizeof(XSegment));
+     memcpy(b->segs + b->nseg, seg, n * sizeof(XSegment));
+     b->nseg += n;
+}
+
+static void
+status_dl_text(int x, int y, Color c, char *str)
+{
+     struct status_dlbatch *b;
+     struct status_dltext *t;
+     struct geo g;
+     int len = strlen(str);
+
+     if(!len)
+          return;
+
+     draw_text_box(dlctx->theme, str, len, &g);
+
+     g.x += x;
+     g.y += y;
+
+     b = status_dl_batch(c, &g);
+
+     status_dl_grow((void**)&b->texts, &b->mtext, b->ntext + 1, sizeof(struct status_dltext));
+
+     t = &b->texts[b->ntext++];
+     t->x   = x;
+     t->y   = y;
+     t->str = str;
+     t->len = len;
+}
+
+/* Draw whole graph, background included, with one request */
+static void
+status_graph_draw(struct status_ctx *ctx, struct status_seq *sq)
+{
+     static XSegment *seg = NULL;
+     static int nseg = 0;
      struct status_gcache *gc;
+     int i, j, n = 0;
+     int ys = sq->geo.y + sq->geo.h - 1;
 
-     /* Graph already exist and have a cache */
-     SLIST_FOREACH(gc, &ctx->gcache, next)
-          if(!strcmp(name, gc->name))
-          {
-               /* shift buffer to remove unused old value */
-               if(gc->ndata > (sq->geo.w << 1))
-                    for(gc->ndata /= 2, j = 0;
-                        j < gc->ndata;
-                        gc->datas[j] = gc->datas[j + gc->ndata], ++j);
-
-               gc->datas[gc->ndata++] = sq->data[1];
-               status_graph_draw(ctx, sq, gc);
+     if(!(gc = status_gcache_get(ctx, sq->str, status_gcache_hash(sq->str))))
+     {
+          status_dl_rect(&sq->geo, sq->color);
+          return;
+     }
+
+     /* Image is put at once, pending primitives under it first */
+     if(W->raster)
+     {
+          status_dl_flush();
+
+          if(raster_graph(ctx->barwin->dr, sq, gc))
                return;
+     }
+
+     status_dl_rect(&sq->geo, sq->color);
+
+     if(nseg < gc->ndata)
+          seg = xrealloc(seg, (nseg = gc->ndata), sizeof(XSegment));
+
+     /* From newest sample at right to oldest */
+     for(i = sq->geo.x + sq->geo.w - 1, j = 1;
+         j <= gc->ndata && i >= sq->geo.x;
+         ++j, --i)
+     {
+          int v = gc->datas[(gc->head - j + gc->size) % gc->size];
+
+          /* You divided by zero didn't you? */
+          if(v)
+          {
+               seg[n].x1 = seg[n].x2 = i;
+               seg[n].y1 = ys - (sq->geo.h / ((float)sq->data[2] / (float)v)) + 1;
+               seg[n].y2 = ys;
+               ++n;
           }
+     }
+
+     status_dl_segments(seg, n, &sq->geo, sq->color2);
+}
+
+/* Append a sample to ring buffer of name, sized for width samples */
+static struct status_gcache*
+status_gcache_push(struct status_ctx *ctx, const char *name, unsigned int h, int width, int value)
+{
+     struct status_gcache *gc;
+     int *datas, size = MAX(width, 1), i, n;
+
+     if(!(gc = status_gcache_get(ctx, name, h)))
+     {
+          gc = xcalloc(1, sizeof(struct status_gcache));
+          gc->name = xstrdup(name);
+          gc->hash = h;
+
+          SLIST_INSERT_HEAD(&ctx->gcache[h % STATUS_GCACHE_BUCKETS], gc, next);
+     }
+
+     /* Graph width changed: keep the newest samples that still fit */
+     if(gc->size != size)
+     {
+          datas = xcalloc(size, sizeof(int));
+          n = MIN(gc->ndata, size);
+
+          for(i = 0; i < n; ++i)
+               datas[n - 1 - i] = gc->datas[(gc->head - 1 - i + gc->size) % gc->size];
+
+          free(gc->datas);
+          gc->datas = datas;
+          gc->size  = size;
+          gc->ndata = n;
+          gc->head  = n % size;
+     }
+
+     gc->datas[gc->head] = value;
+     gc->head = (gc->head + 1) % gc->size;
+
+     if(gc->ndata < gc->size)
+          ++gc->ndata;
+
+     return gc;
+}
 
-     /* No? Make a cache for it */
-     gc = xcalloc(1, sizeof(struct status_gcache));
-     gc->name = xstrdup(name);
-     gc->ndata = 1;
-     gc->datas = xcalloc(sq->geo.w << 2, sizeof(int));
-     gc->datas[0] = sq->data[1];
+/*
+ * Push graph value in its ring buffer; done once per parsed status,
+ * so redraws of the same status don't add samples.
+ */
+static void
+status_graph_push(struct status_ctx *ctx, struct status_seq *sq)
+{
+     struct status_gcache *gc;
+     unsigned int h = status_gcache_hash(sq->str);
 
-     SLIST_INSERT_HEAD(&ctx->gcache, gc, next);
+     /* Graph fed by status_push, value of status string is ignored */
+     if((gc = status_gcache_get(ctx, sq->str, h)) && gc->fed)
+          return;
 
-     status_graph_draw(ctx, sq, gc);
+     status_gcache_push(ctx, sq->str, h, sq->geo.w, sq->data[1]);
+}
+
+/* Last value pushed by status_push to a named progress bar */
+static void
+status_progress_value(struct status_ctx *ctx, struct status_seq *sq)
+{
+     struct status_gcache *gc;
+
+     if((gc = status_gcache_get(ctx, sq->str, status_gcache_hash(sq->str))) && gc->fed)
+          sq->data[1] = gc->datas[(gc->head - 1 + gc->size) % gc->size];
+
+     if(!sq->data[1])
+          sq->data[1] = 1;
+}
+
+/*
+ * Split str on ';' in place, at most narg arguments, the last one
+ * keeps remaining delimiters. Return number of arguments - 1.
+ */
+static int
+status_split(char *str, int narg, char *args[])
+{
+     int i = 0;
+
+     for(args[0] = str; i < narg - 1 && (str = strchr(str, ';')); )
+     {
+          *str++ = '\0';
+          args[++i] = str;
+     }
+
+     return i;
+}
+
+/* Remove \ escaping in place */
+static void
+status_unescape(char *str)
+{
+     char *w;
+
+     if(!(str = w = strchr(str, '\\')))
+          return;
+
+     for(; *str; ++w, ++str)
+     {
+          if(*str == '\\' && str[1])
+               ++str;
+          *w = *str;
+     }
+
+     *w = '\0';
 }
 
 /* Parse mousebind sequence next normal sequence: \<seq>[](button;func;cmd) */
 static char*
-status_parse_mouse(struct status_seq *sq, char *str)
+status_parse_mouse(struct status_arena *a, struct status_seq *sq, char *str)
 {
      struct mousebind *m;
      char *end, *arg[3] = { NULL };
@@ -133,67 +545,77 @@ status_parse_mouse(struct status_seq *sq, char *str)
      if(*str != '(' || !(end = strchr(str, ')')))
           return str;
 
-     i = parse_args(++str, ';', ')', 3, arg);
+     *end = '\0';
+     i = status_split(++str, 3, arg);
 
-     m = xcalloc(1, sizeof(struct mousebind));
+     m = status_arena_alloc(a, sizeof(struct mousebind));
 
      m->use_area = true;
      m->button   = ATOI(arg[0]);
      m->func     = uicb_name_func(arg[1]);
-     m->cmd      = (i > 1 ? xstrdup(arg[2]) : NULL);
+     m->cmd      = (i > 1 ? arg[2] : NULL);
 
      SLIST_INSERT_HEAD(&sq->mousebinds, m, snext);
 
      return end + 1;
 }
 
-#define STATUS_CHECK_ARGS(i, n1, n2, str, end)  \
-     if(i != n1 && i != n2)                     \
-     {                                          \
-          str = end + 2;                        \
-          continue;                             \
-     }
+/*
+ * Parse status string in a copy owned by the ctx arena: every sequence,
+ * mousebind and string of the list points in it, so a parse does no
+ * heap allocation once arena blocks are big enough.
+ * The previous list stays valid until the next parse.
+ */
 void
 status_parse(struct status_ctx *ctx)
 {
-     struct status_seq *sq, *prev = NULL;
+     struct status_arena *a;
+     struct status_seq *sq = NULL, *prev = NULL;
      int i, tmp, shift = 0;
-     char *dstr = xstrdup(ctx->status), *sauv = dstr;
-     char type, *p, *pp, *end, *arg[10] = { NULL };
+     size_t len = strlen(ctx->status);
+     char *dstr, *p, *end, *arg[10] = { NULL };
+#ifdef HAVE_IMLIB2
+     struct stat st;
+#endif /* HAVE_IMLIB2 */
 
-     for(; *dstr; ++dstr)
+     a = &ctx->arena[(ctx->carena ^= 1)];
+     status_arena_reset(a);
+
+     dstr = memcpy(status_arena_alloc(a, len + 1), ctx->status, len + 1);
+
+     for(; (dstr = strpbrk(dstr, "^\\")); )
      {
           /* Check if this is a sequence */
-          if(*dstr != '^' && *dstr != '\\')
-               continue;
-
           p = ++dstr;
 
+          if(!*p || !strchr("sRpPig", *p) || p[1] != '[')
+               continue;
+
           /* Search for correct end of sequence (] without \ behind) */
-          if((end = strchr(p, ']')))
-               while(*(end - 1) == '\\')
-                    end = strchr(end + 1, ']');
+          for(end = p + 1; (end = strchr(end + 1, ']')) && end[-1] == '\\';);
 
-          if(!(strchr("sRpPig", *p)) || !end)
-               continue;
+          if(!end)
+               break;
+
+          *end = '\0';
+          dstr = end + 1;
 
           /* Then parse & list it */
-          switch((type = *p))
+          switch(*p)
           {
           /*
            * Text sequence: \s[left/right;#color;text] OR \s[x;y;#color;text]
            */
           case 's':
-               i = parse_args(p + 2,  ';', ']', 4, arg);
-               STATUS_CHECK_ARGS(i, 2, 3, dstr, end);
-               sq = status_new_seq(type, i, 2, arg, &shift);
+               if((i = status_split(p + 2, 4, arg)) != 2 && i != 3)
+                    continue;
+
+               sq = status_new_seq(a, *p, i, 2, arg, &shift);
 
                sq->color = color_atoh(arg[1 + shift]);
-               sq->str = xstrdup(arg[2 + shift]);
+               sq->str = arg[2 + shift];
 
-               /* Remove \ from string */
-               for(pp = sq->str; (pp = strchr(sq->str, '\\'));)
-                    memmove(pp, pp + 1, strlen(pp));
+               status_unescape(sq->str);
 
                break;
 
@@ -201,9 +623,10 @@ status_parse(struct status_ctx *ctx)
           * Rectangle sequence: \R[left/right;w;h;#color] OR \R[x;y;w;h;#color]
           */
           case 'R':
-               i = parse_args(p + 2, ';', ']', 5, arg);
-               STATUS_CHECK_ARGS(i, 3, 4, dstr, end);
-               sq = status_new_seq(type, i, 3, arg, &shift);
+               if((i = status_split(p + 2, 5, arg)) != 3 && i != 4)
+                    continue;
+
+               sq = status_new_seq(a, *p, i, 3, arg, &shift);
 
                sq->geo.w = ATOI(arg[1 + shift]);
                sq->geo.h = ATOI(arg[2 + shift]);
@@ -212,14 +635,15 @@ status_parse(struct status_ctx *ctx)
                break;
 
           /*
-           * Progress bar sequence: \p[left/right;w;h;bord;val;valmax;bg;fg] OR x;y
-           * Position bar sequence: \P[left/right;w;h;tickbord;val;valmax;bg;fg] OR x;y
+           * Progress bar sequence: \p[left/right;w;h;bord;val;valmax;bg;fg(;name)] OR x;y
+           * Position bar sequence: \P[left/right;w;h;tickbord;val;valmax;bg;fg(;name)] OR x;y
            */
           case 'p':
           case 'P':
-               i = parse_args(p + 2, ';', ']', 9, arg);
-               STATUS_CHECK_ARGS(i, 7, 8, dstr, end);
-               sq = status_new_seq(type, i, 7, arg, &shift);
+               if((i = status_split(p + 2, 10, arg)) < 7 || i > 9)
+                    continue;
+
+               sq = status_new_seq(a, *p, i, 7, arg, &shift);
 
                sq->geo.w = ATOI(arg[1 + shift]);
                sq->geo.h = ATOI(arg[2 + shift]);
@@ -231,15 +655,23 @@ status_parse(struct status_ctx *ctx)
                sq->color   = color_atoh(arg[6 + shift]);
                sq->color2  = color_atoh(arg[7 + shift]);
 
+               /* Named bar can be updated with status_push */
+               if(i - shift == 8)
+               {
+                    sq->str = arg[8 + shift];
+                    status_progress_value(ctx, sq);
+               }
+
                break;
 
           /*
            * Graph sequence: \g[left/right;w;h;val;valmax;bg;fg;name] OR x;y
            */
           case 'g':
-               i = parse_args(p + 2, ';', ']', 9, arg);
-               STATUS_CHECK_ARGS(i, 7, 8, dstr, end);
-               sq = status_new_seq(type, i, 7, arg, &shift);
+               if((i = status_split(p + 2, 9, arg)) != 7 && i != 8)
+                    continue;
+
+               sq = status_new_seq(a, *p, i, 7, arg, &shift);
 
                sq->geo.w = ATOI(arg[1 + shift]);
                sq->geo.h = ATOI(arg[2 + shift]);
@@ -250,24 +682,33 @@ status_parse(struct status_ctx *ctx)
                sq->color   = color_atoh(arg[5 + shift]);
                sq->color2  = color_atoh(arg[6 + shift]);
 
-               sq->str = xstrdup(arg[7 + shift]);
+               sq->str = arg[7 + shift];
+
+               status_graph_push(ctx, sq);
 
                break;
 
           /*
            * Image sequence: \i[left/right;w;h;/path/img] OR \i[x;y;w;h;/path/img]
            */
-#ifdef HAVE_IMLIB2
           case 'i':
-               i = parse_args(p + 2, ';', ']', 5, arg);
-               STATUS_CHECK_ARGS(i, 3, 4, dstr, end);
-               sq = status_new_seq(type, i, 3, arg, &shift);
+#ifdef HAVE_IMLIB2
+               if((i = status_split(p + 2, 5, arg)) != 3 && i != 4)
+                    continue;
+
+               sq = status_new_seq(a, *p, i, 3, arg, &shift);
 
                sq->geo.w = ATOI(arg[1 + shift]);
                sq->geo.h = ATOI(arg[2 + shift]);
-               sq->str   = xstrdup(arg[3 + shift]);
+               sq->str   = arg[3 + shift];
+
+               /* Image file can be rewritten with the same path */
+               if(!stat(sq->str, &st))
+                    sq->mtime = st.st_mtime;
 
                break;
+#else
+               continue;
 #endif /* HAVE_IMLIB2 */
           }
 
@@ -280,18 +721,15 @@ status_parse(struct status_ctx *ctx)
            * Optional mousebind sequence(s) \<seq>[](button;func;cmd)
            * Parse it while there is a mousebind sequence.
            */
-          dstr = end + 1;
-
-          do
-               dstr = status_parse_mouse(sq, dstr);
-          while(*dstr == '(');
-
-          --dstr;
+          while(*dstr == '(')
+          {
+               p = dstr;
+               if((dstr = status_parse_mouse(a, sq, dstr)) == p)
+                    break;
+          }
 
           prev = sq;
      }
-
-     free(sauv);
 }
 
 #define STATUS_ALIGN(align)                                       \
@@ -314,13 +752,17 @@ status_parse(struct status_ctx *ctx)
 #define NOALIGN_Y()                                                     \
      if(sq->align != NoAlign)                                           \
           sq->geo.y = (ctx->barwin->geo.h >> 1) - (sq->geo.h >> 1);
+
+/* Compute geometry of every sequence and of their mousebinds area */
 static void
-status_apply_list(struct status_ctx *ctx)
+status_layout(struct status_ctx *ctx)
 {
      struct status_seq *sq;
      struct mousebind *m;
-     struct geo g;
-     int left = 0, right = 0, w, h;
+     int left = 0, right = 0;
+#ifdef HAVE_IMLIB2
+     int w, h;
+#endif /* HAVE_IMLIB2 */
 
      SLIST_FOREACH(sq, &ctx->statushead, next)
      {
@@ -329,15 +771,13 @@ status_apply_list(struct status_ctx *ctx)
           /* Text */
           case 's':
                sq->geo.w = draw_textw(ctx->theme, sq->str);
-               sq->geo.h = ctx->theme->font.height;
+               sq->geo.h = FONT(ctx->theme)->height;
 
                if(sq->align != NoAlign)
                     sq->geo.y = TEXTY(ctx->theme, ctx->barwin->geo.h);
 
                STATUS_ALIGN(sq->align);
 
-               draw_text(ctx->barwin->dr, ctx->theme, sq->geo.x, sq->geo.y, sq->color, sq->str);
-
                if(!SLIST_EMPTY(&sq->mousebinds))
                     SLIST_FOREACH(m, &sq->mousebinds, snext)
                     {
@@ -347,104 +787,149 @@ status_apply_list(struct status_ctx *ctx)
 
                break;
 
-          /* Rectangle */
+          /* Rectangle, Progress, Position, Graph */
           case 'R':
+          case 'p':
+          case 'P':
+          case 'g':
                NOALIGN_Y();
                STATUS_ALIGN(sq->align);
-
-               draw_rect(ctx->barwin->dr, &sq->geo, sq->color);
-
                STORE_MOUSEBIND();
 
                break;
 
-          /* Progress */
-          case 'p':
-               NOALIGN_Y();
-               STATUS_ALIGN(sq->align);
-
-               draw_rect(ctx->barwin->dr, &sq->geo, sq->color);
-
-               /* Progress bar geo */
-               g.x = sq->geo.x + sq->data[0];
-               g.y = sq->geo.y + sq->data[0];
-               g.w = sq->geo.w - sq->data[0] - sq->data[0];
-               g.h = sq->geo.h - sq->data[0] - sq->data[0];
-
-               if(sq->geo.w > sq->geo.h)
-                    g.w /= ((float)sq->data[2] / (float)sq->data[1]);
-               else
+          /* Image */
+#ifdef HAVE_IMLIB2
+          case 'i':
+               if(sq->geo.w <= 0 || sq->geo.h <= 0)
                {
-                    g.y += g.h;
-                    g.h /= ((float)sq->data[2] / (float)sq->data[1]);
-                    g.y -= g.h;
+                    /* Unknown until decoded, bars are redrawn then */
+                    if(!image_size(sq->str, sq->mtime, &w, &h))
+                    {
+                         ctx->flags |= STATUS_IMAGE_WAIT;
+                         w = h = 0;
+                    }
+
+                    if(sq->geo.w <= 0)
+                         sq->geo.w = w;
+                    if(sq->geo.h <= 0)
+                         sq->geo.h = h;
                }
 
-               draw_rect(ctx->barwin->dr, &g, sq->color2);
+               if(sq->align != NoAlign)
+                    sq->geo.y = (ctx->barwin->geo.h >> 1) - (sq->geo.h >> 1);
 
+               STATUS_ALIGN(sq->align);
                STORE_MOUSEBIND();
 
                break;
+#endif /* HAVE_IMLIB2 */
 
-          /* Position */
-          case 'P':
-               NOALIGN_Y();
-               STATUS_ALIGN(sq->align);
-
-               draw_rect(ctx->barwin->dr, &sq->geo, sq->color);
+          }
+     }
+}
 
-               g.x = sq->geo.x + ((sq->geo.w - sq->data[0]) / ((float)sq->data[2] / (float)sq->data[1]));
-               g.y = sq->geo.y;
-               g.w = sq->data[0];
-               g.h = sq->geo.h;
+/* Progress and position bars: outer rectangle and inner one in */
+static void
+status_draw_bar(struct status_ctx *ctx, struct status_seq *sq, struct geo *in)
+{
+     if(W->raster)
+     {
+          status_dl_flush();
 
-               draw_rect(ctx->barwin->dr, &g, sq->color2);
+          if(raster_rects(ctx->barwin->dr, &sq->geo, sq->color, in, sq->color2))
+               return;
+     }
 
-               STORE_MOUSEBIND();
+     status_dl_rect(&sq->geo, sq->color);
+     status_dl_rect(in, sq->color2);
+}
 
-               break;
+/* Draw a sequence on barwin drawable, status_layout() must be called before */
+static void
+status_draw_seq(struct status_ctx *ctx, struct status_seq *sq)
+{
+     struct geo g;
 
-          /* Graph */
-          case 'g':
-               NOALIGN_Y();
-               STATUS_ALIGN(sq->align);
+     switch(sq->type)
+     {
+     /* Text */
+     case 's':
+          status_dl_text(sq->geo.x, sq->geo.y, sq->color, sq->str);
+          break;
+
+     /* Rectangle */
+     case 'R':
+          status_dl_rect(&sq->geo, sq->color);
+          break;
+
+     /* Progress */
+     case 'p':
+          /* Progress bar geo */
+          g.x = sq->geo.x + sq->data[0];
+          g.y = sq->geo.y + sq->data[0];
+          g.w = sq->geo.w - sq->data[0] - sq->data[0];
+          g.h = sq->geo.h - sq->data[0] - sq->data[0];
+
+          if(sq->geo.w > sq->geo.h)
+               g.w /= ((float)sq->data[2] / (float)sq->data[1]);
+          else
+          {
+               g.y += g.h;
+               g.h /= ((float)sq->data[2] / (float)sq->data[1]);
+               g.y -= g.h;
+          }
 
-               draw_rect(ctx->barwin->dr, &sq->geo, sq->color);
+          status_draw_bar(ctx, sq, &g);
+          break;
 
-               status_graph_process(ctx, sq, sq->str);
+     /* Position */
+     case 'P':
+          g.x = sq->geo.x + ((sq->geo.w - sq->data[0]) / ((float)sq->data[2] / (float)sq->data[1]));
+          g.y = sq->geo.y;
+          g.w = sq->data[0];
+          g.h = sq->geo.h;
 
-               STORE_MOUSEBIND();
+          status_draw_bar(ctx, sq, &g);
+          break;
 
-               break;
+     /* Graph */
+     case 'g':
+          status_graph_draw(ctx, sq);
+          break;
 
-          /* Image */
+     /* Image */
 #ifdef HAVE_IMLIB2
-          case 'i':
-               draw_image_load(sq->str, &w, &h);
+     case 'i':
+          status_dl_flush();
+          if(!image_draw(ctx->barwin->dr, sq->str, sq->mtime, &sq->geo, ctx->barwin->bg))
+               ctx->flags |= STATUS_IMAGE_WAIT;
+          break;
+#endif /* HAVE_IMLIB2 */
+     }
+}
 
-               if(sq->geo.w <= 0)
-                    sq->geo.w = w;
-               if(sq->geo.h <= 0)
-                    sq->geo.h = h;
+static void
+status_apply_list(struct status_ctx *ctx)
+{
+     struct status_seq *sq;
 
-               if(sq->align != NoAlign)
-                    sq->geo.y = (ctx->barwin->geo.h >> 1) - (sq->geo.h >> 1);
+     status_layout(ctx);
 
-               STATUS_ALIGN(sq->align);
-               draw_image(ctx->barwin->dr, &sq->geo);
-               STORE_MOUSEBIND();
+     dlctx = ctx;
 
-               break;
-#endif /* HAVE_IMLIB2 */
+     SLIST_FOREACH(sq, &ctx->statushead, next)
+          status_draw_seq(ctx, sq);
 
-          }
-     }
+     status_dl_flush();
 }
 
 /* Render current statustext of an element */
 void
 status_render(struct status_ctx *ctx)
 {
+     unsigned long req = XNextRequest(W->dpy);
+
      if(!ctx->status)
           return;
 
@@ -461,33 +946,19 @@ status_render(struct status_ctx *ctx)
      else
           status_apply_list(ctx);
 
+     ctx->w = ctx->barwin->geo.w;
+     ctx->h = ctx->barwin->geo.h;
+     ctx->damage.w = ctx->damage.h = 0;
+
      barwin_refresh(ctx->barwin);
+
+     stats_status_render(XNextRequest(W->dpy) - req);
 }
 
+/* Sequences memory is owned by ctx arenas */
 void
 status_flush_list(struct status_ctx *ctx)
 {
-     struct status_seq *sq;
-     struct mousebind *m;
-
-     /* Flush previous linked list of status sequences */
-     while(!SLIST_EMPTY(&ctx->statushead))
-     {
-          sq = SLIST_FIRST(&ctx->statushead);
-          SLIST_REMOVE_HEAD(&ctx->statushead, next);
-
-          while(!SLIST_EMPTY(&sq->mousebinds))
-          {
-               m = SLIST_FIRST(&sq->mousebinds);
-               SLIST_REMOVE_HEAD(&sq->mousebinds, snext);
-               free((void*)m->cmd);
-               free(m);
-          }
-
-          free(sq->str);
-          free(sq);
-     }
-
      SLIST_INIT(&ctx->statushead);
 }
 
@@ -510,17 +981,183 @@ status_copy_mousebind(struct status_ctx *ctx)
      }
 }
 
+/* Area painted by a sequence */
+static void
+status_seq_box(struct status_ctx *ctx, struct status_seq *sq, struct geo *g)
+{
+     *g = sq->geo;
+
+     /* Text y is the baseline */
+     if(sq->type == 's')
+          g->y -= FONT(ctx->theme)->as;
+}
+
+static void
+geo_union(struct geo *d, struct geo *g)
+{
+     int x2, y2;
+
+     if(g->w <= 0 || g->h <= 0)
+          return;
+
+     if(d->w <= 0 || d->h <= 0)
+     {
+          *d = *g;
+          return;
+     }
+
+     x2 = MAX(d->x + d->w, g->x + g->w);
+     y2 = MAX(d->y + d->h, g->y + g->h);
+
+     d->x = MIN(d->x, g->x);
+     d->y = MIN(d->y, g->y);
+     d->w = x2 - d->x;
+     d->h = y2 - d->y;
+}
+
+/* Changed box: in bounding box d, and marked in barwin damage */
+static void
+status_damage(struct status_ctx *ctx, struct geo *d, struct geo *g)
+{
+     geo_union(d, g);
+
+     if(ctx->barwin)
+          barwin_damage(ctx->barwin, g->x, g->y, g->w, g->h);
+}
+
+/*
+ * Redraw sequences within damage bounding box, clipped to the
+ * rectangles marked in barwin damage, and copy only those.
+ */
+static void
+status_repaint(struct status_ctx *ctx, struct geo *damage)
+{
+     struct barwin *b = ctx->barwin;
+     struct status_seq *sq;
+     struct geo g;
+     unsigned long req = XNextRequest(W->dpy);
+
+     if(damage->w <= 0 || damage->h <= 0)
+          return;
+
+     if(!b->damage || XEmptyRegion(b->damage))
+          barwin_damage(b, damage->x, damage->y, damage->w, damage->h);
+
+     draw_set_clip_region(b->damage);
+
+     draw_rect(b->dr, damage, b->bg);
+
+     dlctx = ctx;
+
+     SLIST_FOREACH(sq, &ctx->statushead, next)
+     {
+          status_seq_box(ctx, sq, &g);
+
+          if(geo_overlap(&g, damage))
+               status_draw_seq(ctx, sq);
+     }
+
+     status_dl_flush();
+
+     draw_set_clip(NULL);
+
+     barwin_refresh(b);
+
+     stats_status_render(XNextRequest(W->dpy) - req);
+}
+
+/* Sequences are painted the same way */
+static bool
+status_seq_samedraw(struct status_seq *a, struct status_seq *b)
+{
+     /* A graph has a new sample at every parse */
+     if(a->type != b->type || a->type == 'g')
+          return false;
+
+     return (GEOCMP(a->geo, b->geo)
+             && a->color == b->color
+             && a->color2 == b->color2
+             && a->mtime == b->mtime
+             && !memcmp(a->data, b->data, sizeof(a->data))
+             && ((!a->str && !b->str) || (a->str && b->str && !strcmp(a->str, b->str))));
+}
+
+/*
+ * Diff new sequence list against the previous one: changed sequences
+ * are redrawn clipped to the bounding box of their old and new area,
+ * and only that box is copied to the window.
+ * Return false if a full render is needed.
+ */
+static bool
+status_diff(struct status_ctx *ctx, struct status_seq *old)
+{
+     struct status_seq *sq, *o;
+     struct geo g, damage = ctx->damage;
+     bool mchange = false;
+
+     if(ctx->flags & STATUS_BLOCK_REFRESH
+        || SLIST_EMPTY(&ctx->statushead) || !old
+        || ctx->w != ctx->barwin->geo.w || ctx->h != ctx->barwin->geo.h)
+          return false;
+
+     /* Sequence lists must match one to one */
+     for(sq = SLIST_FIRST(&ctx->statushead), o = old;
+         sq && o;
+         sq = SLIST_NEXT(sq, next), o = SLIST_NEXT(o, next));
+
+     if(sq || o)
+          return false;
+
+     status_layout(ctx);
+
+     for(sq = SLIST_FIRST(&ctx->statushead), o = old;
+         sq;
+         sq = SLIST_NEXT(sq, next), o = SLIST_NEXT(o, next))
+     {
+          if(!status_seq_samedraw(sq, o))
+          {
+               status_seq_box(ctx, sq, &g);
+               status_damage(ctx, &damage, &g);
+               status_seq_box(ctx, o, &g);
+               status_damage(ctx, &damage, &g);
+          }
+
+          if(!SLIST_EMPTY(&sq->mousebinds) || !SLIST_EMPTY(&o->mousebinds))
+               mchange = true;
+     }
+
+     /* Previous list memory is reused at next parse: relink mousebinds */
+     if(mchange)
+          status_copy_mousebind(ctx);
+
+     status_repaint(ctx, &damage);
+
+     return true;
+}
+
 /* Parse and render statustext */
 void
 status_manage(struct status_ctx *ctx)
 {
+     struct status_seq *old;
+
      if(!ctx->status)
           return;
 
      ctx->update = false;
 
-     status_flush_list(ctx);
+     /* Previous list stays valid in the other arena until next parse */
+     old = SLIST_FIRST(&ctx->statushead);
+     SLIST_INIT(&ctx->statushead);
+
      status_parse(ctx);
+
+     if(status_diff(ctx, old))
+     {
+          ctx->damage.w = ctx->damage.h = 0;
+          return;
+     }
+
      status_render(ctx);
      status_copy_mousebind(ctx);
 }
@@ -550,7 +1187,7 @@ status_surface(int x, int y, int w, int h, Color bg, char *status)
           return;
 
      if(x + y < 0)
-          XQueryPointer(W->dpy, W->root, (Window*)&d, (Window*)&d, &x, &y, &d, &d, (unsigned int *)&d);
+          stats_xquerypointer(W->dpy, W->root, (Window*)&d, (Window*)&d, &x, &y, &d, &d, (unsigned int *)&d);
 
      s = screen_gb_geo(x, y);
 
@@ -597,6 +1234,89 @@ uicb_status_surface(Uicb cmd)
      free(ccmd);
 }
 
+/** Append samples to a named graph and set value of named progress
+ * bars, without status parse; their area is added to ctx damage
+ * \param ctx Status context
+ * \param name Graph or progress bar name
+ * \param v Samples, oldest first
+ * \param n Number of samples
+ * \return true if something is to repaint
+ */
+bool
+status_push(struct status_ctx *ctx, const char *name, const int *v, int n)
+{
+     struct status_gcache *gc;
+     struct status_seq *sq;
+     struct geo g;
+     unsigned int h = status_gcache_hash(name);
+     int i, width = 0;
+     bool found = false;
+
+     if(n <= 0)
+          return false;
+
+     SLIST_FOREACH(sq, &ctx->statushead, next)
+          if(sq->str && strchr("gpP", sq->type) && !strcmp(sq->str, name))
+          {
+               if(sq->type == 'g')
+                    width = MAX(width, sq->geo.w);
+
+               found = true;
+          }
+
+     if(!found)
+          return false;
+
+     /* Progress bars only need the last value */
+     if(!width)
+          width = ((gc = status_gcache_get(ctx, name, h)) ? gc->size : 1);
+
+     for(i = 0; i < n; ++i)
+          gc = status_gcache_push(ctx, name, h, width, v[i]);
+
+     gc->fed = true;
+
+     SLIST_FOREACH(sq, &ctx->statushead, next)
+          if(sq->str && strchr("gpP", sq->type) && !strcmp(sq->str, name))
+          {
+               if(sq->type != 'g')
+                    sq->data[1] = (v[n - 1] ? v[n - 1] : 1);
+
+               status_seq_box(ctx, sq, &g);
+               status_damage(ctx, &ctx->damage, &g);
+          }
+
+     return true;
+}
+
+/** Repaint damage area of status set by status_push
+ * \param ctx Status context
+ */
+void
+status_flush_damage(struct status_ctx *ctx)
+{
+     if(ctx->barwin && !(ctx->flags & STATUS_BLOCK_REFRESH)
+        && ctx->w == ctx->barwin->geo.w && ctx->h == ctx->barwin->geo.h)
+          status_repaint(ctx, &ctx->damage);
+
+     ctx->damage.w = ctx->damage.h = 0;
+}
+
+/* Replace status text, reuse buffer when it is big enough */
+void
+status_set(struct status_ctx *ctx, const char *str)
+{
+     size_t len = strlen(str);
+
+     if(ctx->status && strlen(ctx->status) >= len)
+          memcpy(ctx->status, str, len + 1);
+     else
+     {
+          free(ctx->status);
+          ctx->status = xstrdup(str);
+     }
+}
+
 /* Syntax: "<infobar name> <status string>" */
 void
 uicb_status(Uicb cmd)
@@ -617,10 +1337,100 @@ uicb_status(Uicb cmd)
           SLIST_FOREACH(ib, &s->infobars, next)
                if(!strcmp(cmd, ib->name))
                {
-                    free(ib->statusctx.status);
-                    ib->statusctx.status = xstrdup(p);
+                    status_set(&ib->statusctx, p);
                     ib->statusctx.update = true;
-                    infobar_elem_screen_update(s, ElemStatus);
+                    infobar_status_dirty(ib);
                }
      }
 }
+
+/* Syntax: "<infobar name> <segment name> <status string>" */
+void
+uicb_status_set(Uicb cmd)
+{
+     struct status_segment *sg;
+     struct infobar *ib;
+     struct screen *s;
+     char *seg, *p;
+
+     if(!cmd || !(seg = strchr(cmd, ' ')))
+          return;
+
+     *seg++ = '\0';
+
+     /* Empty status is allowed to clear a segment */
+     if((p = strchr(seg, ' ')))
+          *p++ = '\0';
+     else
+          p = seg + strlen(seg);
+
+     SLIST_FOREACH(s, &W->h.screen, next)
+          SLIST_FOREACH(ib, &s->infobars, next)
+          {
+               if(strcmp(cmd, ib->name))
+                    continue;
+
+               SLIST_FOREACH(sg, &ib->segments, next)
+                    if(!strcmp(seg, sg->name))
+                    {
+                         status_set(&sg->ctx, p);
+                         sg->ctx.update = true;
+                         infobar_segment_dirty(ib);
+                    }
+          }
+}
+
+/* Syntax: "<infobar name> <graph/progress name> <value> [<value>...]" */
+void
+uicb_status_push(Uicb cmd)
+{
+     static int *v = NULL;
+     static int nv = 0;
+     struct status_segment *sg;
+     struct infobar *ib;
+     struct screen *s;
+     char *name, *p, *end;
+     int n = 0;
+     bool dirty;
+
+     if(!cmd || !(name = strchr(cmd, ' ')))
+          return;
+
+     *name++ = '\0';
+
+     if(!(p = strchr(name, ' ')))
+          return;
+
+     *p++ = '\0';
+
+     for(;; p = end)
+     {
+          long l = strtol(p, &end, 10);
+
+          if(end == p)
+               break;
+
+          if(n == nv)
+               v = xrealloc(v, (nv = (nv ? nv << 1 : 16)), sizeof(int));
+
+          v[n++] = (int)l;
+     }
+
+     if(!n)
+          return;
+
+     SLIST_FOREACH(s, &W->h.screen, next)
+          SLIST_FOREACH(ib, &s->infobars, next)
+          {
+               if(strcmp(cmd, ib->name))
+                    continue;
+
+               dirty = status_push(&ib->statusctx, name, v, n);
+
+               SLIST_FOREACH(sg, &ib->segments, next)
+                    dirty |= status_push(&sg->ctx, name, v, n);
+
+               if(dirty)
+                    infobar_segment_dirty(ib);
+          }
+}
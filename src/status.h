@@ -16,8 +16,13 @@ void status_copy_mousebind(struct status_ctx *ctx);
 void status_parse(struct status_ctx *ctx);
 void status_render(struct status_ctx *ctx);
 void status_manage(struct status_ctx *ctx);
+void status_set(struct status_ctx *ctx, const char *str);
+bool status_push(struct status_ctx *ctx, const char *name, const int *v, int n);
+void status_flush_damage(struct status_ctx *ctx);
 void status_flush_surface(void);
 void uicb_status(Uicb cmd);
+void uicb_status_set(Uicb cmd);
+void uicb_status_push(Uicb cmd);
 void uicb_status_surface(Uicb cmd);
 
 #endif /* STATUS_H */
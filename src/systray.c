@@ -7,6 +7,7 @@
 #include "systray.h"
 #include "ewmh.h"
 #include "infobar.h"
+#include "winmap.h"
 
 #define SYSTRAY_SPACING (2)
 
@@ -50,10 +51,10 @@ systray_acquire(void)
           return;
      }
 
-     ewmh_send_message(W->root, W->root, "MANAGER", CurrentTime,
+     ewmh_send_message(W->root, W->root, W->net_atom[manager], CurrentTime,
                        W->net_atom[net_system_tray_s], w, 0, 0);
 
-     XSync(W->dpy, false);
+     stats_xsync(W->dpy, false);
 
      W->systray.win = w;
 }
@@ -76,10 +77,11 @@ systray_add(Window win)
      XSelectInput(W->dpy, s->win, StructureNotifyMask | PropertyChangeMask| EnterWindowMask | FocusChangeMask);
      XReparentWindow(W->dpy, s->win, W->systray.win, 0, 0);
 
-     ewmh_send_message(s->win, s->win, "_XEMBED", CurrentTime,
+     ewmh_send_message(s->win, s->win, W->net_atom[xembed], CurrentTime,
                        XEMBED_EMBEDDED_NOTIFY, 0, W->systray.win, 0);
 
      SLIST_INSERT_HEAD(&W->systray.head, s, next);
+     winmap_add(s->win, WinSystray, s);
 
      W->systray.redim = true;
 }
@@ -91,6 +93,7 @@ systray_del(struct _systray *s)
           return;
 
      SLIST_REMOVE(&W->systray.head, s, _systray, next);
+     winmap_del(s->win, WinSystray);
      free(s);
 
      W->systray.redim = true;
@@ -118,7 +121,7 @@ systray_state(struct _systray *s)
           ewmh_set_wm_state(s->win, WithdrawnState);
      }
 
-     ewmh_send_message(s->win, s->win, "_XEMBED", CurrentTime, code, 0, 0, 0);
+     ewmh_send_message(s->win, s->win, W->net_atom[xembed], CurrentTime, code, 0, 0, 0);
 }
 
 void
@@ -133,6 +136,7 @@ systray_freeicons(void)
      {
           i = SLIST_FIRST(&W->systray.head);
           SLIST_REMOVE_HEAD(&W->systray.head, next);
+          winmap_del(i->win, WinSystray);
 
           XUnmapWindow(W->dpy, i->win);
           XReparentWindow(W->dpy, i->win, W->root, 0, 0);
@@ -142,22 +146,16 @@ systray_freeicons(void)
      XSetSelectionOwner(W->dpy, W->net_atom[net_system_tray_s], None, CurrentTime);
      W->systray.barwin->geo.w = 0;
      infobar_elem_reinit(W->systray.infobar);
-     XSync(W->dpy, false);
+     stats_xsync(W->dpy, false);
 }
 
 struct _systray*
 systray_find(Window win)
 {
-     struct _systray *i;
-
      if(!(W->flags & WMFS_SYSTRAY))
           return NULL;
 
-     SLIST_FOREACH(i, &W->systray.head, next)
-          if(i->win == win)
-               return i;
-
-     return NULL;
+     return winmap_get(win, WinSystray);
 }
 
 int
@@ -62,7 +62,8 @@ tag_screen(struct screen *s, struct tag *t)
 
      t->flags &= ~TAG_URGENT;
 
-     infobar_elem_screen_update(s, ElemTag);
+     infobar_tag_dirty(t->prev);
+     infobar_tag_dirty(t);
 
      ewmh_update_wmfs_props();
 }
@@ -94,7 +95,7 @@ tag_client(struct tag *t, struct client *c)
      /* Client remove */
      if(!t)
      {
-          infobar_elem_screen_update(c->screen, ElemTag);
+          infobar_tag_dirty(c->tag);
           return;
      }
 
@@ -106,7 +107,8 @@ tag_client(struct tag *t, struct client *c)
 
      SLIST_INSERT_HEAD(&t->clients, c, tnext);
 
-     infobar_elem_screen_update(c->screen, ElemTag);
+     infobar_tag_dirty(c->prevtag);
+     infobar_tag_dirty(t);
 
      if(c->flags & CLIENT_TABMASTER && c->prevtag)
      {
@@ -34,12 +34,18 @@
      X##t##Window(W->dpy, w);     \
 } while( /* CONSTCOND */ 0);
 
-#define ATOM(a)             XInternAtom(W->dpy, (a), False)
+#define ATOM(a)             stats_xinternatom(W->dpy, (a), False)
 #define LEN(x)              (sizeof(x) / sizeof(*x))
 #define FLAGINT(i)          (1 << i)
 #define FLAGAPPLY(f, b, m)  (f |= (b ? m : 0))
 #define ATOI(s)             strtol(s, NULL, 10)
 #define ABS(j)              (j < 0 ? -j : j)
+#ifndef MIN
+#define MIN(a, b)           ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)           ((a) > (b) ? (a) : (b))
+#endif
 #define INAREA(i, j, a)     ((i) >= (a).x && (i) <= (a).x + (a).w && (j) >= (a).y && (j) <= (a).y + (a).h)
 #define GEOCMP(g1, g2)      ((g1).x == (g2).x && (g1).y == (g2).y && (g1).w == (g2).w && (g1).h == (g2).h)
 
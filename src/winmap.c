@@ -0,0 +1,145 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#include "winmap.h"
+#include "util.h"
+
+/*
+ * Open addressing hash table (linear probing) of every
+ * window managed by wmfs, keyed by (XID, object type).
+ * Entry with win == None is empty.
+ */
+
+#define WINMAP_MINSIZE 256
+
+static inline size_t
+winmap_hash(Window w, enum wintype type)
+{
+     unsigned long h = (unsigned long)w * 2654435761UL + type;
+
+     return (h ^ (h >> 16)) & (W->winmap.size - 1);
+}
+
+static struct winmap*
+winmap_slot(Window w, enum wintype type)
+{
+     size_t i = winmap_hash(w, type);
+     struct winmap *e;
+
+     for(e = &W->winmap.tab[i]; e->win != None; e = &W->winmap.tab[i])
+     {
+          if(e->win == w && e->type == type)
+               break;
+
+          i = (i + 1) & (W->winmap.size - 1);
+     }
+
+     return e;
+}
+
+static void
+winmap_resize(size_t size)
+{
+     struct winmap *old = W->winmap.tab;
+     size_t i, osize = W->winmap.size;
+
+     W->winmap.tab  = xcalloc(size, sizeof(struct winmap));
+     W->winmap.size = size;
+
+     for(i = 0; i < osize; ++i)
+          if(old[i].win != None)
+               *winmap_slot(old[i].win, old[i].type) = old[i];
+
+     free(old);
+}
+
+void
+winmap_init(void)
+{
+     W->winmap.tab  = NULL;
+     W->winmap.size = 0;
+     W->winmap.n    = 0;
+
+     winmap_resize(WINMAP_MINSIZE);
+}
+
+void
+winmap_free(void)
+{
+     free(W->winmap.tab);
+     W->winmap.tab = NULL;
+     W->winmap.size = W->winmap.n = 0;
+}
+
+/** Map a window to an object, replace previous mapping if any
+ * \param w Window
+ * \param type Type of object
+ * \param ptr Object pointer
+ */
+void
+winmap_add(Window w, enum wintype type, void *ptr)
+{
+     struct winmap *e;
+
+     if(w == None)
+          return;
+
+     /* Keep load factor under 1/2 */
+     if((W->winmap.n + 1) << 1 > W->winmap.size)
+          winmap_resize(W->winmap.size << 1);
+
+     if((e = winmap_slot(w, type))->win == None)
+          ++W->winmap.n;
+
+     e->win  = w;
+     e->type = type;
+     e->ptr  = ptr;
+}
+
+/** Remove a window mapping, shifting back next entries
+ *  of the cluster so no tombstone is needed
+ * \param w Window
+ * \param type Type of object
+ */
+void
+winmap_del(Window w, enum wintype type)
+{
+     size_t i, j, k, mask = W->winmap.size - 1;
+     struct winmap *tab = W->winmap.tab;
+
+     if(w == None || (tab[(i = winmap_slot(w, type) - tab)]).win == None)
+          return;
+
+     for(j = (i + 1) & mask; tab[j].win != None; j = (j + 1) & mask)
+     {
+          k = winmap_hash(tab[j].win, tab[j].type);
+
+          /* Move entry j in hole i if its home slot k isn't in ]i, j] */
+          if((j > i && (k <= i || k > j))
+             || (j < i && (k <= i && k > j)))
+          {
+               tab[i] = tab[j];
+               i = j;
+          }
+     }
+
+     tab[i].win = None;
+     tab[i].ptr = NULL;
+     --W->winmap.n;
+}
+
+/** Get object mapped to a window
+ * \param w Window
+ * \param type Type of object
+ * \return Object pointer or NULL
+ */
+void*
+winmap_get(Window w, enum wintype type)
+{
+     if(w == None)
+          return NULL;
+
+     return winmap_slot(w, type)->ptr;
+}
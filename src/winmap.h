@@ -0,0 +1,17 @@
+/*
+ *  wmfs2 by Martin Duquesnoy <xorg62@gmail.com> { for(i = 2011; i < 2111; ++i) ©(i); }
+ *  For license, see COPYING.
+ */
+
+#ifndef WINMAP_H
+#define WINMAP_H
+
+#include "wmfs.h"
+
+void winmap_init(void);
+void winmap_free(void);
+void winmap_add(Window w, enum wintype type, void *ptr);
+void winmap_del(Window w, enum wintype type);
+void *winmap_get(Window w, enum wintype type);
+
+#endif /* WINMAP_H */
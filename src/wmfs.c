@@ -19,17 +19,27 @@
 #include "ewmh.h"
 #include "screen.h"
 #include "infobar.h"
+#include "barwin.h"
 #include "util.h"
 #include "config.h"
 #include "client.h"
 #include "layout.h"
 #include "systray.h"
+#include "loop.h"
+#include "winmap.h"
+#include "fifo.h"
+#include "provider.h"
+#include "raster.h"
+#include "image.h"
+#include "draw.h"
 
 int
 wmfs_error_handler(Display *d, XErrorEvent *event)
 {
       char mess[256];
 
+      stats_xerror(event->request_code);
+
       /* Check if there is another WM running */
       if(event->error_code == BadAccess
                 && W->root == event->resourceid)
@@ -81,27 +91,51 @@ wmfs_numlockmask(void)
      XFreeModifiermap(mm);
 }
 
+/* Open a font of the cache, called by FONT() at first use */
 void
-wmfs_init_font(char *font, struct theme *t)
+wmfs_init_font(struct font *f)
 {
      XFontStruct **xfs = NULL;
      char **misschar, **names, *defstring;
      int d;
 
-     if(!(t->font.fontset = XCreateFontSet(W->dpy, font, &misschar, &d, &defstring)))
+     f->loaded = true;
+
+#ifdef HAVE_XFT
+     /* Metrics are known at open, glyphs are uploaded at first use */
+     if(f->usexft)
+     {
+          if((f->xft = XftFontOpenName(W->dpy, W->xscreen, f->name)))
+          {
+               f->as     = f->xft->ascent;
+               f->de     = f->xft->descent;
+               f->width  = f->xft->max_advance_width;
+               f->height = f->as + f->de;
+
+               return;
+          }
+
+          warnxl("Can't load Xft font '%s'", f->name);
+     }
+#else
+     if(f->usexft)
+          warnxl("Xft support not compiled, using core font '%s'", f->name);
+#endif /* HAVE_XFT */
+
+     if(!(f->fontset = XCreateFontSet(W->dpy, f->name, &misschar, &d, &defstring)))
      {
-          warnxl("Can't load font '%s'", font);
-          t->font.fontset = XCreateFontSet(W->dpy, "fixed", &misschar, &d, &defstring);
+          warnxl("Can't load font '%s'", f->name);
+          f->fontset = XCreateFontSet(W->dpy, "fixed", &misschar, &d, &defstring);
      }
 
-     XExtentsOfFontSet(t->font.fontset);
-     XFontsOfFontSet(t->font.fontset, &xfs, &names);
+     XExtentsOfFontSet(f->fontset);
+     XFontsOfFontSet(f->fontset, &xfs, &names);
 
-     t->font.as    = xfs[0]->max_bounds.ascent;
-     t->font.de    = xfs[0]->max_bounds.descent;
-     t->font.width = xfs[0]->max_bounds.width;
+     f->as    = xfs[0]->max_bounds.ascent;
+     f->de    = xfs[0]->max_bounds.descent;
+     f->width = xfs[0]->max_bounds.width;
 
-     t->font.height = t->font.as + t->font.de;
+     f->height = f->as + f->de;
 
      if(misschar)
           XFreeStringList(misschar);
@@ -162,6 +196,13 @@ wmfs_xinit(void)
       */
      SLIST_INIT(&W->h.barwin);
      SLIST_INIT(&W->h.vbarwin);
+     SLIST_INIT(&W->pixpool.free);
+     SLIST_INIT(&W->pixpool.scratch);
+
+     /*
+      * Window -> object hash table
+      */
+     winmap_init();
 
      /*
       * Optional dep init
@@ -218,18 +259,18 @@ wmfs_scan(void)
      W->flags |= WMFS_SCAN;
 
      /* Get previous selected tag to apply it at the end */
-     if(XGetWindowProperty(W->dpy, W->root, W->net_atom[wmfs_current_tag], 0, 32,
-                           False, XA_CARDINAL, &rt, &rf, &ir, &il,
-                           (unsigned char**)&tret)
+     if(stats_xgetwindowproperty(W->dpy, W->root, W->net_atom[wmfs_current_tag], 0, 32,
+                                 False, XA_CARDINAL, &rt, &rf, &ir, &il,
+                                 (unsigned char**)&tret)
                == Success && tret)
      {
           nscreen = (int)ir;
      }
 
      /* Previous focused client before reload */
-     if(XGetWindowProperty(W->dpy, W->root, W->net_atom[wmfs_focus], 0, 32,
-                           False, XA_WINDOW, &rt, &rf, &ir, &il,
-                           (unsigned char**)&ret)
+     if(stats_xgetwindowproperty(W->dpy, W->root, W->net_atom[wmfs_focus], 0, 32,
+                                 False, XA_WINDOW, &rt, &rf, &ir, &il,
+                                 (unsigned char**)&ret)
                == Success && ret)
      {
           focus = *ret;
@@ -240,7 +281,7 @@ wmfs_scan(void)
      if(XQueryTree(W->dpy, W->root, &usl, &usl2, &w, (unsigned int*)&n))
           for(i = n - 1; i != -1; --i)
           {
-               XGetWindowAttributes(W->dpy, w[i], &wa);
+               stats_xgetwindowattributes(W->dpy, w[i], &wa);
 
                if(!wa.override_redirect && wa.map_state == IsViewable)
                {
@@ -250,27 +291,27 @@ wmfs_scan(void)
                          continue;
                     }
 
-                    if(XGetWindowProperty(W->dpy, w[i], ATOM("_WMFS_TAG"), 0, 32,
-                                          False, XA_CARDINAL, &rt, &rf, &ir, &il,
-                                          (unsigned char**)&ret)
+                    if(stats_xgetwindowproperty(W->dpy, w[i], W->net_atom[wmfs_tag], 0, 32,
+                                                False, XA_CARDINAL, &rt, &rf, &ir, &il,
+                                                (unsigned char**)&ret)
                               == Success && ret)
                     {
                          tag = *ret;
                          XFree(ret);
                     }
 
-                    if(XGetWindowProperty(W->dpy, w[i], ATOM("_WMFS_SCREEN"), 0, 32,
-                                          False, XA_CARDINAL, &rt, &rf, &ir, &il,
-                                          (unsigned char**)&ret)
+                    if(stats_xgetwindowproperty(W->dpy, w[i], W->net_atom[wmfs_screen], 0, 32,
+                                                False, XA_CARDINAL, &rt, &rf, &ir, &il,
+                                                (unsigned char**)&ret)
                               == Success && ret)
                     {
                          screen = *ret;
                          XFree(ret);
                     }
 
-                    if(XGetWindowProperty(W->dpy, w[i], ATOM("_WMFS_FLAGS"), 0, 32,
-                                          False, XA_CARDINAL, &rt, &rf, &ir, &il,
-                                          (unsigned char**)&ret)
+                    if(stats_xgetwindowproperty(W->dpy, w[i], W->net_atom[wmfs_flags], 0, 32,
+                                                False, XA_CARDINAL, &rt, &rf, &ir, &il,
+                                                (unsigned char**)&ret)
                               == Success && ret)
                     {
                          flags = *ret;
@@ -278,9 +319,9 @@ wmfs_scan(void)
                          XFree(ret);
                     }
 
-                    if(XGetWindowProperty(W->dpy, w[i], ATOM("_WMFS_GEO"), 0, 32,
-                                          False, XA_CARDINAL, &rt, &rf, &ir, &il,
-                                          (unsigned char**)&ret)
+                    if(stats_xgetwindowproperty(W->dpy, w[i], W->net_atom[wmfs_geo], 0, 32,
+                                                False, XA_CARDINAL, &rt, &rf, &ir, &il,
+                                                (unsigned char**)&ret)
                               == Success && ret)
                     {
                          g.x = ret[0];
@@ -292,9 +333,9 @@ wmfs_scan(void)
                          XFree(ret);
                     }
 
-                    if(XGetWindowProperty(W->dpy, w[i], ATOM("_WMFS_TABMASTER"), 0, 32,
-                                          False, XA_WINDOW, &rt, &rf, &ir, &il,
-                                          (unsigned char**)&ret)
+                    if(stats_xgetwindowproperty(W->dpy, w[i], W->net_atom[wmfs_tabmaster], 0, 32,
+                                                False, XA_WINDOW, &rt, &rf, &ir, &il,
+                                                (unsigned char**)&ret)
                               == Success && ret)
                     {
                          tm = *ret;
@@ -362,7 +403,7 @@ wmfs_scan(void)
           XFree(tret);
 
      XFree(w);
-     XSync(W->dpy, false);
+     stats_xsync(W->dpy, false);
 }
 
 static inline void
@@ -370,21 +411,62 @@ wmfs_sigchld(void)
 {
      if(W->flags & WMFS_SIGCHLD)
      {
+          /* Clear flag first to not miss a signal raised while reaping */
+          W->flags &= ~WMFS_SIGCHLD;
           while(waitpid(-1, NULL, WNOHANG) > 0);
-          W->flags ^= WMFS_SIGCHLD;
      }
 }
 
+/* Work of the loop itself, between X events and poll */
+static void
+wmfs_loop_work(void)
+{
+     /* Manage SIGCHLD event here, X is not safe with it */
+     wmfs_sigchld();
+
+     loop_run_timers();
+
+     /* Redraw what events and timers changed in infobars */
+     infobar_render_dirty();
+}
+
 static void
 wmfs_loop(void)
 {
      XEvent ev;
 
-     while((W->flags & WMFS_RUNNING) && !XNextEvent(W->dpy, &ev))
+     /* X connection is polled with other sources, events are read below */
+     loop_add_fd(ConnectionNumber(W->dpy), NULL, NULL);
+
+     while(W->flags & WMFS_RUNNING)
      {
-          /* Manage SIGCHLD event here, X is not safe with it */
-          wmfs_sigchld();
-          EVENT_HANDLE(&ev);
+          while(XPending(W->dpy))
+          {
+               if(!(W->flags & WMFS_INPUTPRIO) || !event_next_input(&ev))
+                    XNextEvent(W->dpy, &ev);
+
+               event_coalesce(&ev);
+
+               /* One flush of layout changes per event */
+               layout_begin();
+
+               if(W->stats)
+                    stats_event_handle(&ev);
+               else
+               {
+                    EVENT_HANDLE(&ev);
+                    layout_commit();
+               }
+          }
+
+          stats_loop_run(wmfs_loop_work);
+
+          /* Never sleep with events already read in Xlib queue */
+          if(!(W->flags & WMFS_RUNNING)
+             || XEventsQueued(W->dpy, QueuedAfterFlush))
+               continue;
+
+          loop_poll();
      }
 }
 
@@ -397,6 +479,7 @@ wmfs_init(void)
      screen_init();
      event_init();
      config_init();
+     fifo_init();
 }
 
 void
@@ -434,7 +517,7 @@ wmfs_quit(void)
      {
           t = SLIST_FIRST(&W->h.theme);
           SLIST_REMOVE_HEAD(&W->h.theme, next);
-          XFreeFontSet(W->dpy, t->font.fontset);
+          font_release(t->font);
           status_free_ctx(&t->tags_n_sl);
           status_free_ctx(&t->tags_s_sl);
           status_free_ctx(&t->tags_o_sl);
@@ -444,6 +527,9 @@ wmfs_quit(void)
           free(t);
      }
 
+     /* Widths of freed fonts */
+     draw_free();
+
      while(!SLIST_EMPTY(&W->h.keybind))
      {
           k = SLIST_FIRST(&W->h.keybind);
@@ -481,9 +567,31 @@ wmfs_quit(void)
           free(r);
      }
 
+     fifo_free();
+     provider_free();
+     raster_free();
+     barwin_pool_free();
+#ifdef HAVE_IMLIB2
+     image_free();
+#endif /* HAVE_IMLIB2 */
+     loop_free();
+     winmap_free();
+     stats_free();
+
      /* close log */
      if(W->log)
+     {
+          fprintf(W->log, "events folded: configure %lu, property %lu, expose %lu\n"
+                          "events reordered: %lu\n"
+                          "infobar renders saved: %lu\n"
+                          "status updates dropped: %lu\n"
+                          "pixmaps created: %lu, reused: %lu\n"
+                          "fifo commands: %lu\n",
+                  W->evstats.configure, W->evstats.property, W->evstats.expose,
+                  W->evstats.reordered, W->render_saved, W->status_dropped,
+                  W->pixpool.created, W->pixpool.reused, W->fifo.ncmd);
           fclose(W->log), W->log = NULL;
+     }
 
      W->flags &= ~WMFS_RUNNING;
 }
@@ -510,26 +618,29 @@ uicb_quit(Uicb cmd)
 static void
 exec_uicb_function(Display *dpy, Window root, char *func, char *cmd)
 {
-     Atom utf8s = XInternAtom(dpy, "UTF8_STRING", false);
+     static char *name[] = { "UTF8_STRING", "_WMFS_FUNCTION", "_WMFS_CMD" };
+     Atom a[LEN(name)];
      XClientMessageEvent e = {
           .type         = ClientMessage,
-          .message_type = XInternAtom(dpy, "_WMFS_FUNCTION", false),
           .window       = root,
           .format       = 32,
           .data.l[4]    = true
      };
 
-     XChangeProperty(dpy,root, XInternAtom(dpy, "_WMFS_FUNCTION", false), utf8s,
+     XInternAtoms(dpy, name, LEN(name), False, a);
+     e.message_type = a[1];
+
+     XChangeProperty(dpy,root, a[1], a[0],
                      8, PropModeReplace, (unsigned char*)func, strlen(func));
 
      if(!cmd)
           cmd = "";
 
-     XChangeProperty(dpy, root, XInternAtom(dpy, "_WMFS_CMD", false), utf8s,
+     XChangeProperty(dpy, root, a[2], a[0],
                      8, PropModeReplace, (unsigned char*)cmd, strlen(cmd));
 
      XSendEvent(dpy, root, false, StructureNotifyMask, (XEvent*)&e);
-     XSync(dpy, False);
+     stats_xsync(dpy, False);
 }
 
 static void
@@ -545,6 +656,8 @@ signal_handle(int sig)
           W->flags |= WMFS_SIGCHLD;
           break;
      }
+
+     loop_signal();
 }
 
 int
@@ -593,7 +706,7 @@ main(int argc, char **argv)
                break;
 
                case 'C':
-                    strncpy(path, optarg, sizeof(W->confpath));
+                    strncpy(path, optarg, sizeof(path) - 1);
                     break;
           }
      }
@@ -610,6 +723,8 @@ main(int argc, char **argv)
           exit(EXIT_FAILURE);
      }
 
+     loop_init();
+
      /* Set signal handler */
      memset(&sa, 0, sizeof(sa));
      sa.sa_handler = signal_handle;
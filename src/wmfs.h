@@ -20,6 +20,19 @@
 /* Xlib */
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
+
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif /* HAVE_XSHM */
+
+#ifdef HAVE_IMLIB2
+#include <pthread.h>
+#endif /* HAVE_IMLIB2 */
+
+#ifdef HAVE_XFT
+#include <X11/Xft/Xft.h>
+#endif /* HAVE_XFT */
 
 /* Local */
 #include "log.h"
@@ -84,12 +97,27 @@ struct colpair
      Color fg, bg;
 };
 
+/* Pooled back buffer of barwins, see barwin.c */
+struct pixmap
+{
+     Pixmap p;
+     int depth;
+     int w, h;
+     int refs; /* Titlebars sharing a scratch pixmap */
+     SLIST_ENTRY(pixmap) next;
+};
+
 struct barwin
 {
-     struct geo geo;
+     struct geo geo; /* Logical size, pixmap may be larger */
      Window win;
      Drawable dr;
+     struct pixmap *pix;
+     Region damage; /* Area to copy at next refresh */
      Color fg, bg;
+#define BARWIN_DIRTY   0x01
+#define BARWIN_SCRATCH 0x02 /* Draw in shared scratch pixmap */
+     Flags flags;
      void *ptr; /* Special cases */
      SLIST_HEAD(mbhead, mousebind) mousebinds;
      SLIST_HEAD(, mousebind) statusmousebinds;
@@ -105,37 +133,94 @@ struct status_seq
      int data[4];
      char type;
      char *str;
+     time_t mtime;
      Color color, color2;
      SLIST_HEAD(, mousebind) mousebinds;
      SLIST_ENTRY(status_seq) next;
 };
 
+/* Bump allocator, blocks are kept across resets */
+struct status_arena_block
+{
+     size_t size, used;
+     SLIST_ENTRY(status_arena_block) next;
+     char data[];
+};
+
+struct status_arena
+{
+     struct status_arena_block *cur;
+     SLIST_HEAD(, status_arena_block) blocks;
+};
+
 struct status_ctx
 {
      struct barwin *barwin;
      struct theme *theme;
 #define STATUS_BLOCK_REFRESH 0x01
+#define STATUS_IMAGE_WAIT    0x02 /* Drawn without an image not decoded yet */
      Flags flags;
      char *status;
      bool update;
-     SLIST_HEAD(, status_gcache) gcache;
+     int w, h; /* barwin size at last render */
+     struct geo damage; /* Area to repaint without parse */
+     /* Parsed list lives in arena[carena], previous one in the other */
+     struct status_arena arena[2];
+     int carena;
+#define STATUS_GCACHE_BUCKETS 16
+     SLIST_HEAD(, status_gcache) gcache[STATUS_GCACHE_BUCKETS];
      SLIST_HEAD(, status_seq) statushead;
 };
 
+/* Graph samples ring buffer, capacity is graph width */
 struct status_gcache
 {
      char *name;
+     unsigned int hash;
      int *datas;
-     int ndata;
+     int size, head, ndata; /* head: next sample slot */
+     bool fed; /* Samples pushed by status_push, not by parse */
      SLIST_ENTRY(status_gcache) next;
 };
 
+/* Text of status display list */
+struct status_dltext
+{
+     int x, y, len;
+     char *str;
+};
+
+/* Primitives of one color pending in status display list */
+struct status_dlbatch
+{
+     Color color;
+     XRectangle *rects;
+     XSegment *segs;
+     struct status_dltext *texts;
+     struct geo *boxes; /* Area of every primitive, for overlap tests */
+     int nrect, nseg, ntext, nbox;
+     int mrect, mseg, mtext, mbox;
+};
+
+/* Named part of a status element, with its own barwin and status */
+struct status_segment
+{
+     char *name;
+     int width;
+     enum position align;
+     struct status_ctx ctx;
+     SLIST_ENTRY(status_segment) next;
+};
+
 struct element
 {
      struct geo geo;
      struct infobar *infobar;
      struct status_ctx *statusctx;
      int type;
+#define ELEM_DIRTY        0x01 /* Whole element */
+#define ELEM_DIRTY_BUTTON 0x02 /* Some barwins of element: tag buttons, status segments */
+     Flags flags;
      char *data;
      enum position align;
      void (*func_init)(struct element *e);
@@ -152,6 +237,16 @@ struct infobar
      struct theme *theme;
      struct status_ctx statusctx;
      enum barpos pos;
+     char *status_template;
+     SLIST_HEAD(, status_segment) segments;
+     /* Status repaint rate limit in Hz, 0 for none */
+     int rate;
+     long lastrender;
+#define INFOBAR_PENDING_STATUS  0x01
+#define INFOBAR_PENDING_SEGMENT 0x02
+     Flags pending;
+     struct timer *ratetimer;
+     unsigned long dropped;
      char *elemorder;
      char *name;
      TAILQ_HEAD(esub, element) elements;
@@ -195,6 +290,7 @@ struct client
      struct screen *screen;
      struct barwin *titlebar;
      struct geo geo, wgeo, tgeo, ttgeo, rgeo, *tbgeo;
+     struct geo xgeo, xwgeo; /* Last frame/window geo sent to X */
      struct colpair ncol, scol;
      struct theme *theme;
      struct client *tabmaster;
@@ -216,6 +312,7 @@ struct client
 #define CLIENT_FREE          0x1000
 #define CLIENT_TILED         0x2000
 #define CLIENT_MOUSE         0x4000
+#define CLIENT_CONFIGURE     0x8000 /* ConfigureNotify pending */
      Flags flags;
      Window win, frame, tmp;
      SLIST_ENTRY(client) next;   /* Global list */
@@ -250,16 +347,37 @@ struct mousebind
      SLIST_ENTRY(mousebind) globnext;
 };
 
+/* Cached width of a string, see draw.c */
+struct textw
+{
+     void *font;
+     unsigned int hash;
+     int len;
+     unsigned short w;
+     char *str;
+};
+
+/* Font shared by themes, opened at first use: see FONT() */
+struct font
+{
+     char *name;
+     char *locale;
+     bool usexft;
+     bool loaded;
+     int refs;
+     int as, de, width, height;
+     XFontSet fontset;
+#ifdef HAVE_XFT
+     XftFont *xft; /* Used instead of fontset if not NULL */
+#endif /* HAVE_XFT */
+     SLIST_ENTRY(font) next;
+};
+
 struct theme
 {
      char *name;
 
-     /* Font */
-     struct
-     {
-          int as, de, width, height;
-          XFontSet fontset;
-     } font;
+     struct font *font;
 
      /* Bars */
      struct colpair bars;
@@ -296,6 +414,19 @@ struct rule
      SLIST_ENTRY(rule) next;
 };
 
+struct provider
+{
+     char *name;
+     char *token; /* "${name}" */
+     char *arg;
+     char value[64];
+     bool (*update)(struct provider *p);
+     unsigned long long prev[2];
+     long prevtime;
+     struct timer *timer;
+     SLIST_ENTRY(provider) next;
+};
+
 struct launcher
 {
      char *name;
@@ -322,7 +453,138 @@ struct _systray
      SLIST_ENTRY(_systray) next;
 };
 
+enum wintype
+{
+     WinClient = 0,
+     WinFrame,
+     WinTitlebar,
+     WinBarwin,
+     WinSystray,
+     WinLast
+};
+
+struct winmap
+{
+     Window win;
+     enum wintype type;
+     void *ptr;
+};
+
+struct fdsource
+{
+     int fd;
+     void (*func)(int fd, void *arg);
+     void *arg;
+     SLIST_ENTRY(fdsource) next;
+};
+
+struct timer
+{
+     long expire;
+     int interval;
+     bool armed;
+     void (*func)(void *arg);
+     void *arg;
+     SLIST_ENTRY(timer) next;
+};
+
+enum stats_sync_call
+{
+     StatsXSync = 0,
+     StatsXGetWindowProperty,
+     StatsXQueryPointer,
+     StatsXGetWindowAttributes,
+     StatsXInternAtom,
+     StatsSyncLast
+};
+
+/* Client side rasterizer, see raster.c */
+struct raster
+{
+     XImage *img;
+#ifdef HAVE_XSHM
+     XShmSegmentInfo shm;
+     bool useshm;
+     bool shmimg;    /* img is attached to shm, puts are completed */
+     int completion; /* ShmCompletion event type */
+     int inflight;   /* XShmPutImage not completed */
+     int cursor;     /* x of img free area while inflight */
+#endif /* HAVE_XSHM */
+     int *top;
+     int ntop;
+};
+
+#ifdef HAVE_IMLIB2
+/* Image of status cache, see image.c */
+struct image_entry
+{
+     char *path;
+     int w, h;   /* Scaled size, 0 for natural size only */
+     int rw, rh; /* Natural size */
+     time_t mtime;
+     Color bg;
+     unsigned int hash;
+#define IMAGE_PENDING 0x01
+#define IMAGE_FAILED  0x02
+     Flags flags;
+     Pixmap pixmap;
+     size_t size;
+     unsigned long gen; /* image_cache gen of last use */
+     SLIST_ENTRY(image_entry) next;
+     TAILQ_ENTRY(image_entry) lru;
+};
+
+/* Decoding of an entry by the worker thread */
+struct image_job
+{
+     struct image_entry *entry;
+     char *path;
+     int w, h, rw, rh;
+     Color bg;
+     unsigned int *data;
+     TAILQ_ENTRY(image_job) next;
+};
+
+#define IMAGE_CACHE_BUCKETS 64
+
+struct image_cache
+{
+     SLIST_HEAD(, image_entry) bucket[IMAGE_CACHE_BUCKETS];
+     TAILQ_HEAD(image_lru, image_entry) lru; /* Most recently used first */
+     size_t used, cap;
+     unsigned long gen; /* Bumped at each batch of decoded images */
+     /* jobs: to decode, done: decoded, both under lock */
+     TAILQ_HEAD(, image_job) jobs, done;
+     pthread_t thread;
+     pthread_mutex_t lock;
+     pthread_cond_t cond;
+     bool stop;
+     int pipe[2];
+     struct fdsource *src;
+};
+#endif /* HAVE_IMLIB2 */
+
+#define STATS_NEV     256 /* Same as MAX_EV */
+#define STATS_LOOP    STATS_NEV /* Loop work: timers, render */
+#define STATS_FD      (STATS_NEV + 1) /* Fd source callbacks */
+#define STATS_NSLOT   (STATS_NEV + 2)
+#define STATS_NBUCKET 20  /* log2(us) latency buckets, last is >= 2^19us */
+
+struct stats
+{
+     /* Type of event being handled, STATS_LOOP or STATS_FD out of events, 0 else */
+     int cur;
+     unsigned long count[STATS_NSLOT];
+     unsigned long hist[STATS_NSLOT][STATS_NBUCKET];
+     unsigned long total[STATS_NSLOT], max[STATS_NSLOT]; /* us */
+     unsigned long sync[STATS_NSLOT][StatsSyncLast];
+     unsigned long xerror[256];
+     /* X requests sent by status renders */
+     unsigned long status_render, status_req, status_reqmax;
+};
+
 #define MAX_PATH_LEN 8192
+#define FIFO_BUFSIZ  4096
 
 struct wmfs
 {
@@ -342,6 +604,8 @@ struct wmfs
 #define WMFS_LAUNCHER 0x20
 #define WMFS_SIGCHLD  0x40
 #define WMFS_TABNOC   0x80 /* tab next opened client */
+#define WMFS_INPUTPRIO 0x100 /* dispatch input events first */
+#define WMFS_DIRTY     0x200 /* infobar element to redraw */
      Flags flags;
      GC gc, rgc;
      Atom *net_atom;
@@ -353,6 +617,67 @@ struct wmfs
      /* Log file */
      FILE *log;
 
+     /* Layout transaction, see layout_begin() */
+     struct
+     {
+          int depth;
+          int pending;
+     } trans;
+
+     /* Window -> object hash table */
+     struct
+     {
+          struct winmap *tab;
+          size_t size, n;
+     } winmap;
+
+     /* Signal self-pipe, wake up main loop */
+     int sigfd[2];
+
+     /* Command FIFO, see fifo_init() */
+     struct
+     {
+          char *path;
+          int fd;
+          struct fdsource *src;
+          char buf[FIFO_BUFSIZ];
+          size_t len;
+          unsigned long ncmd;
+     } fifo;
+
+     /* Events merged by event_coalesce, moved by event_next_input */
+     struct
+     {
+          unsigned long configure;
+          unsigned long property;
+          unsigned long expose;
+          unsigned long reordered;
+     } evstats;
+
+     /* Infobar redraws skipped by dirty tracking */
+     unsigned long render_saved;
+
+     /* Status updates coalesced by infobar rate limit */
+     unsigned long status_dropped;
+
+     /* Instrumentation, NULL when disabled */
+     struct stats *stats;
+
+     /* Graph and progress bar rasterizer, NULL when disabled */
+     struct raster *raster;
+
+     /* Status images cache, NULL without Imlib2 */
+     struct image_cache *image;
+
+     /* Barwins back buffers pool */
+     struct
+     {
+          SLIST_HEAD(, pixmap) free;
+          SLIST_HEAD(, pixmap) scratch;
+          int nfree;
+          unsigned long created, reused;
+     } pixpool;
+
      /* Lists heads */
      struct
      {
@@ -361,10 +686,14 @@ struct wmfs
           SLIST_HEAD(, keybind) keybind;
           SLIST_HEAD(, barwin) barwin;
           SLIST_HEAD(, theme) theme;
+          SLIST_HEAD(, font) font;
           SLIST_HEAD(, rule) rule;
           SLIST_HEAD(, mousebind) mousebind;
           SLIST_HEAD(, launcher) launcher;
           SLIST_HEAD(, barwin) vbarwin;
+          SLIST_HEAD(, fdsource) fdsource;
+          SLIST_HEAD(, timer) timer;
+          SLIST_HEAD(, provider) provider;
      } h;
 
      /*
@@ -404,7 +733,7 @@ int wmfs_error_handler(Display *d, XErrorEvent *event);
 int wmfs_error_handler_dummy(Display *d, XErrorEvent *event);
 void wmfs_grab_keys(void);
 void wmfs_numlockmask(void);
-void wmfs_init_font(char *font, struct theme *t);
+void wmfs_init_font(struct font *f);
 void wmfs_quit(void);
 void uicb_reload(Uicb cmd);
 void uicb_quit(Uicb cmd);
@@ -412,4 +741,6 @@ void uicb_quit(Uicb cmd);
 /* Single global variable */
 struct wmfs *W;
 
+#include "stats.h"
+
 #endif /* WMFS_H */